@@ -34,4 +34,339 @@ __kernel void step_kernel_mod(
 		// update temperatures
 		temp_out[i00] = temp_in[i00]+fact*(d2tdx2 + d2tdy2);
 	  }
-}
\ No newline at end of file
+}
+//-------------------------------------------------------------
+//
+//  Specialised kernel, only built when the host passes
+//  -DSPEC_NI=.. -DSPEC_NJ=.. -DSPEC_FACT=.. so that bounds,
+//  strides and the coefficient are compile time constants
+//
+//-------------------------------------------------------------
+
+#ifdef SPEC_NI
+__kernel void step_kernel_spec(
+					__global const float* restrict temp_in,
+					__global float* restrict temp_out)
+{
+	int j = get_global_id(1) + 1;
+	int i = get_global_id(0) + 1;
+
+	if(i < SPEC_NI-1 && j < SPEC_NJ-1) {
+		// neighbours are at constant offsets from the central point
+		int i00 = I2D(SPEC_NI, i, j);
+
+		// evaluate derivatives
+		float d2tdx2 = temp_in[i00-1]-2*temp_in[i00]+temp_in[i00+1];
+		float d2tdy2 = temp_in[i00-SPEC_NI]-2*temp_in[i00]+temp_in[i00+SPEC_NI];
+
+		// update temperatures
+		temp_out[i00] = temp_in[i00]+SPEC_FACT*(d2tdx2 + d2tdy2);
+	}
+}
+#endif
+
+//-------------------------------------------------------------
+//
+//  Per-row checksum of interior cells, used to validate
+//  a run without reading the whole field back
+//
+//-------------------------------------------------------------
+
+__kernel void row_checksum(
+					int ni,
+					int nj,
+					__global const float* temp,
+					__global float* sums)
+{
+	int j = get_global_id(0) + 1;
+
+	if(j < nj-1) {
+		float sum = 0;
+		for(int i = 1; i < ni-1; i++)
+			sum += temp[I2D(ni, i, j)];
+		sums[j] = sum;
+	}
+}
+
+//-------------------------------------------------------------
+//
+//  In-situ analytics: min, max, sum and a histogram of the
+//  interior cells, reduced per work-group to partial results
+//  that stats_finish folds into one record. The constants
+//  must match the ANALYTICS_* ones in analytics.h
+//
+//-------------------------------------------------------------
+
+// sums are kept in double where the device has it and as a
+// float pair hi + lo otherwise, so they do not drift from the
+// host's double sum on large fields. Either way they leave a
+// kernel as the float pair.
+#ifdef cl_khr_fp64
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double stats_sum;
+
+stats_sum sum_of(float t) { return t; }
+stats_sum sum_add(stats_sum a, stats_sum b) { return a + b; }
+stats_sum sum_join(float hi, float lo) { return (double)hi + lo; }
+
+float2 sum_split(stats_sum a)
+{
+	float hi = (float)a;
+	return (float2)(hi, (float)(a - hi));
+}
+#else
+typedef float2 stats_sum;
+
+stats_sum sum_of(float t) { return (float2)(t, 0.0f); }
+stats_sum sum_join(float hi, float lo) { return (float2)(hi, lo); }
+float2 sum_split(stats_sum a) { return a; }
+
+// two-sum of the high parts, their rounding error is carried in lo
+stats_sum sum_add(stats_sum a, stats_sum b)
+{
+	float s = a.x + b.x;
+	float v = s - a.x;
+	float e = (a.x - (s - v)) + (b.x - v) + a.y + b.y;
+	float hi = s + e;
+	return (float2)(hi, e - (hi - s));
+}
+#endif
+
+#define STATS_WG     16      // work-groups are STATS_WG x STATS_WG
+#define STATS_LOCAL  (STATS_WG*STATS_WG)
+#define STATS_BINS   16
+#define STATS_PROBES 8
+#define STATS_T_MIN  0.0f
+#define STATS_T_MAX  100.0f
+#define STATS_PART   4       // min, max and the sum pair per group
+#define STATS_REC    (4 + STATS_BINS + STATS_PROBES)
+
+int stats_bin(float t)
+{
+	int b = (int)((t - STATS_T_MIN) * (STATS_BINS / (STATS_T_MAX - STATS_T_MIN)));
+	return clamp(b, 0, STATS_BINS-1);
+}
+
+// tree reduction over the work-group, the result ends up in element 0
+void stats_reduce(int l, __local float* lmin, __local float* lmax, __local stats_sum* lsum)
+{
+	for(int s = STATS_LOCAL/2; s > 0; s >>= 1) {
+		barrier(CLK_LOCAL_MEM_FENCE);
+		if(l < s) {
+			lmin[l] = fmin(lmin[l], lmin[l+s]);
+			lmax[l] = fmax(lmax[l], lmax[l+s]);
+			lsum[l] = sum_add(lsum[l], lsum[l+s]);
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+// reduces one value per work-item, inside is false for padding items
+void stats_group(float t, bool inside,
+				__local float* lmin, __local float* lmax, __local stats_sum* lsum,
+				__local uint* lhist,
+				__global float* partial, __global uint* phist)
+{
+	int l = get_local_id(1)*STATS_WG + get_local_id(0);
+	int g = get_group_id(1)*get_num_groups(0) + get_group_id(0);
+
+	if(l < STATS_BINS)
+		lhist[l] = 0;
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	if(inside)
+		atomic_inc(&lhist[stats_bin(t)]);
+	lmin[l] = inside ? t : FLT_MAX;
+	lmax[l] = inside ? t : -FLT_MAX;
+	lsum[l] = sum_of(inside ? t : 0.0f);
+	stats_reduce(l, lmin, lmax, lsum);
+
+	if(l == 0) {
+		float2 s = sum_split(lsum[0]);
+		partial[STATS_PART*g]   = lmin[0];
+		partial[STATS_PART*g+1] = lmax[0];
+		partial[STATS_PART*g+2] = s.x;
+		partial[STATS_PART*g+3] = s.y;
+	}
+	if(l < STATS_BINS)
+		phist[g*STATS_BINS + l] = lhist[l];
+}
+
+//-------------------------------------------------------------
+//
+//  step_kernel_mod fused with the reduction of the new field,
+//  global size is the interior rounded up to whole groups
+//
+//-------------------------------------------------------------
+
+__kernel __attribute__((reqd_work_group_size(STATS_WG, STATS_WG, 1)))
+void step_kernel_stats(
+					int ni,
+					int nj,
+					float fact,
+					__global float* temp_in,
+					__global float* temp_out,
+					__global float* partial,
+					__global uint* phist)
+{
+	__local float lmin[STATS_LOCAL], lmax[STATS_LOCAL];
+	__local stats_sum lsum[STATS_LOCAL];
+	__local uint lhist[STATS_BINS];
+
+	int j = get_global_id(1) + 1;
+	int i = get_global_id(0) + 1;
+	bool inside = i < ni-1 && j < nj-1;
+	float t = 0.0f;
+
+	if(inside) {
+		int i00 = I2D(ni, i, j);
+
+		// evaluate derivatives
+		float d2tdx2 = temp_in[i00-1]-2*temp_in[i00]+temp_in[i00+1];
+		float d2tdy2 = temp_in[i00-ni]-2*temp_in[i00]+temp_in[i00+ni];
+
+		// update temperatures
+		t = temp_in[i00]+fact*(d2tdx2 + d2tdy2);
+		temp_out[i00] = t;
+	}
+
+	stats_group(t, inside, lmin, lmax, lsum, lhist, partial, phist);
+}
+
+//-------------------------------------------------------------
+//
+//  Reduction of a field without a step, for runs whose step
+//  kernel is not fused
+//
+//-------------------------------------------------------------
+
+__kernel __attribute__((reqd_work_group_size(STATS_WG, STATS_WG, 1)))
+void field_stats(
+					int ni,
+					int nj,
+					__global const float* temp,
+					__global float* partial,
+					__global uint* phist)
+{
+	__local float lmin[STATS_LOCAL], lmax[STATS_LOCAL];
+	__local stats_sum lsum[STATS_LOCAL];
+	__local uint lhist[STATS_BINS];
+
+	int j = get_global_id(1) + 1;
+	int i = get_global_id(0) + 1;
+	bool inside = i < ni-1 && j < nj-1;
+
+	stats_group(inside ? temp[I2D(ni, i, j)] : 0.0f, inside,
+				lmin, lmax, lsum, lhist, partial, phist);
+}
+
+//-------------------------------------------------------------
+//
+//  Folds the partial results of all groups and samples the
+//  probe points into record slot, run as a single work-group
+//  of STATS_LOCAL items. Floats are stored as their bits,
+//  the sum as the float pair hi, lo.
+//
+//-------------------------------------------------------------
+
+__kernel __attribute__((reqd_work_group_size(STATS_LOCAL, 1, 1)))
+void stats_finish(
+					int ni,
+					int groups,
+					int nprobe,
+					int slot,
+					__global const float* partial,
+					__global const uint* phist,
+					__global const float* temp,
+					__global const int* probes,
+					__global uint* records)
+{
+	__local float lmin[STATS_LOCAL], lmax[STATS_LOCAL];
+	__local stats_sum lsum[STATS_LOCAL];
+	__local uint lcount[STATS_LOCAL];
+
+	int l = get_local_id(0);
+	__global uint* rec = records + slot*STATS_REC;
+	float mn = FLT_MAX, mx = -FLT_MAX;
+	stats_sum sum = sum_of(0.0f);
+	uint count = 0;
+
+	for(int g = l; g < groups; g += STATS_LOCAL) {
+		const __global float* p = partial + STATS_PART*g;
+		mn = fmin(mn, p[0]);
+		mx = fmax(mx, p[1]);
+		sum = sum_add(sum, sum_join(p[2], p[3]));
+	}
+	// each bin is summed by STATS_LOCAL/STATS_BINS items
+	for(int g = l / STATS_BINS; g < groups; g += STATS_LOCAL / STATS_BINS)
+		count += phist[g*STATS_BINS + l % STATS_BINS];
+
+	lmin[l] = mn;
+	lmax[l] = mx;
+	lsum[l] = sum;
+	lcount[l] = count;
+	stats_reduce(l, lmin, lmax, lsum);
+
+	if(l == 0) {
+		float2 s = sum_split(lsum[0]);
+		rec[0] = as_uint(lmin[0]);
+		rec[1] = as_uint(lmax[0]);
+		rec[2] = as_uint(s.x);
+		rec[3] = as_uint(s.y);
+	}
+	if(l < STATS_BINS) {
+		uint c = 0;
+		for(int k = l; k < STATS_LOCAL; k += STATS_BINS)
+			c += lcount[k];
+		rec[4 + l] = c;
+	}
+	if(l < nprobe)
+		rec[4 + STATS_BINS + l] = as_uint(temp[I2D(ni, probes[2*l], probes[2*l+1])]);
+}
+
+//-------------------------------------------------------------
+//
+//  In-situ rendering: interior cells averaged over scale x
+//  scale blocks and mapped onto a palette, one work-item per
+//  pixel. The constants must match the RENDER_* ones in
+//  render.h
+//
+//-------------------------------------------------------------
+
+#define RENDER_COLORS 256
+#define RENDER_T_MIN  0.0f
+#define RENDER_T_MAX  100.0f
+
+uchar render_color(float t)
+{
+	int c = (int)((t - RENDER_T_MIN) * ((RENDER_COLORS - 1) / (RENDER_T_MAX - RENDER_T_MIN)) + 0.5f);
+	return (uchar)clamp(c, 0, RENDER_COLORS-1);
+}
+
+__kernel void render_frame(
+					int ni,
+					int nj,
+					int scale,
+					int w,
+					__global const float* temp,
+					__global uchar* image)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	float sum = 0.0f;
+	int n = 0;
+
+	for(int j = 1 + y*scale; j < 1 + (y+1)*scale && j < nj-1; j++)
+		for(int i = 1 + x*scale; i < 1 + (x+1)*scale && i < ni-1; i++) {
+			sum += temp[I2D(ni, i, j)];
+			n++;
+		}
+
+	// a field without interior cells (ni or nj <= 2) shows its boundary
+	if(n == 0) {
+		sum = temp[I2D(ni, min(1, ni-1), min(1, nj-1))];
+		n = 1;
+	}
+
+	image[I2D(w, x, y)] = render_color(sum / n);
+}
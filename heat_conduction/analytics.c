@@ -0,0 +1,415 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: In-situ analytics
+//
+//  PURPOSE: Min, max, mean, energy, a histogram and probe temperatures of
+//           the interior cells, computed where the field lives so only a
+//           record of a hundred bytes leaves the device per sample. Device
+//           steps that are sampled run step_kernel_stats, which reduces the
+//           new field per work-group in the same pass; stats_finish folds
+//           the partial results and the probes into one record slot.
+//           ANALYTICS_BATCH records are read back at once and appended to a
+//           CSV time series.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include <float.h>
+#include "heat_sim.h"
+
+#define REC_WORDS (4 + ANALYTICS_BINS + ANALYTICS_MAX_PROBES)   // of a stats_finish record
+#define PART_WORDS 4                                             // per work-group, min, max, sum hi, lo
+
+struct analytics_dev {
+	cl_command_queue queue;
+	cl_kernel kfused, kfield, kfinish;
+	cl_mem partial, phist, probes, records;
+	int ni, nj, nprobe;
+	int groups;                       // work-groups of the stats kernels
+	size_t global[2];
+	int steps[ANALYTICS_BATCH];       // step of each record on the device
+	int pending;
+	cl_uint words[ANALYTICS_BATCH * REC_WORDS];
+	struct analytics_rec *recs;
+	int count;
+	FILE *log;
+};
+
+// same arithmetic as stats_bin in the kernels, so both bin a value alike
+static int bin_of(float t)
+{
+	int b = (int)((t - ANALYTICS_T_MIN) * (ANALYTICS_BINS / (ANALYTICS_T_MAX - ANALYTICS_T_MIN)));
+	return b < 0 ? 0 : (b >= ANALYTICS_BINS ? ANALYTICS_BINS - 1 : b);
+}
+
+static void fill_rec(int ni, int nj, const float *temp, int nprobe, const int *probes,
+                     float mn, float mx, double sum, const unsigned int *hist,
+                     struct analytics_rec *rec)
+{
+	rec->min = mn;
+	rec->max = mx;
+	rec->energy = sum;
+	rec->mean = sum / ((double)(ni - 2) * (nj - 2));
+	memcpy(rec->hist, hist, sizeof(rec->hist));
+	for (int k = 0; k < nprobe; k++)
+		rec->probe[k] = temp[I2D(ni, probes[2*k], probes[2*k+1])];
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to summarise the interior of a field on the host. probes holds
+//  nprobe (i, j) pairs.
+//
+//------------------------------------------------------------------------------
+void analytics_field_ref(int ni, int nj, const float *temp,
+                         int nprobe, const int *probes, struct analytics_rec *rec)
+{
+	float mn = FLT_MAX, mx = -FLT_MAX;
+	double sum = 0;
+	unsigned int hist[ANALYTICS_BINS] = {0};
+
+	#pragma omp parallel
+	{
+		unsigned int myHist[ANALYTICS_BINS] = {0};
+
+		#pragma omp for schedule(static) reduction(min:mn) reduction(max:mx) reduction(+:sum)
+		for ( int j = 1; j < nj-1; j++ ) {
+			const float *row = temp + I2D(ni, 0, j);
+			float rowMin = FLT_MAX, rowMax = -FLT_MAX;
+			double rowSum = 0;
+
+			#pragma omp simd reduction(min:rowMin) reduction(max:rowMax) reduction(+:rowSum)
+			for ( int i = 1; i < ni-1; i++ ) {
+				rowMin = fminf(rowMin, row[i]);
+				rowMax = fmaxf(rowMax, row[i]);
+				rowSum += row[i];
+			}
+			for ( int i = 1; i < ni-1; i++ )
+				myHist[bin_of(row[i])]++;
+
+			mn = fminf(mn, rowMin);
+			mx = fmaxf(mx, rowMax);
+			sum += rowSum;
+		}
+
+		#pragma omp critical
+		for (int b = 0; b < ANALYTICS_BINS; b++)
+			hist[b] += myHist[b];
+	}
+
+	fill_rec(ni, nj, temp, nprobe, probes, mn, mx, sum, hist, rec);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run one host step and summarise the new field in the same pass
+//
+//------------------------------------------------------------------------------
+void analytics_step_ref(int ni, int nj, float fact, const float *temp_in, float *temp_out,
+                        int nprobe, const int *probes, struct analytics_rec *rec)
+{
+	float mn = FLT_MAX, mx = -FLT_MAX;
+	double sum = 0;
+	unsigned int hist[ANALYTICS_BINS] = {0};
+
+	#pragma omp parallel
+	{
+		unsigned int myHist[ANALYTICS_BINS] = {0};
+		TRACE_BEGIN(t0);
+
+		#pragma omp for schedule(static) reduction(min:mn) reduction(max:mx) reduction(+:sum)
+		for ( int j = 1; j < nj-1; j++ ) {
+			float rowMin = FLT_MAX, rowMax = -FLT_MAX;
+			double rowSum = 0;
+
+			for ( int i = 1; i < ni-1; i++ ) {
+				size_t i00 = I2D(ni, i, j);
+
+				// same update as step_kernel_ref
+				float d2tdx2 = temp_in[i00-1]-2*temp_in[i00]+temp_in[i00+1];
+				float d2tdy2 = temp_in[i00-ni]-2*temp_in[i00]+temp_in[i00+ni];
+				float t = temp_in[i00]+fact*(d2tdx2 + d2tdy2);
+				temp_out[i00] = t;
+
+				rowMin = fminf(rowMin, t);
+				rowMax = fmaxf(rowMax, t);
+				rowSum += t;
+				myHist[bin_of(t)]++;
+			}
+
+			mn = fminf(mn, rowMin);
+			mx = fmaxf(mx, rowMax);
+			sum += rowSum;
+		}
+
+		#pragma omp critical
+		for (int b = 0; b < ANALYTICS_BINS; b++)
+			hist[b] += myHist[b];
+
+		TRACE_END(t0, "cpu step", "cpu");
+	}
+
+	fill_rec(ni, nj, temp_out, nprobe, probes, mn, mx, sum, hist, rec);
+}
+
+// reads back the records on the device and appends them to the log
+static void flush(struct analytics_dev *a)
+{
+	cl_int err;
+	cl_event event = NULL;
+
+	if (a->pending == 0)
+		return;
+
+	err = clEnqueueReadBuffer(a->queue, a->records, CL_TRUE, 0,
+		sizeof(cl_uint) * REC_WORDS * a->pending, a->words, 0, NULL, TRACE_EVENT(event));
+	checkError(err, "Reading back analytics");
+	TRACE_CL(event, "read stats", "transfer");
+
+	for (int k = 0; k < a->pending; k++) {
+		const cl_uint *w = a->words + k * REC_WORDS;
+		struct analytics_rec rec;
+		float hi, lo;   // the device sum is hi + lo
+
+		rec.step = a->steps[k];
+		memcpy(&rec.min, &w[0], sizeof(float));
+		memcpy(&rec.max, &w[1], sizeof(float));
+		memcpy(&hi, &w[2], sizeof(float));
+		memcpy(&lo, &w[3], sizeof(float));
+		rec.energy = (double)hi + lo;
+		rec.mean = rec.energy / ((double)(a->ni - 2) * (a->nj - 2));
+		for (int b = 0; b < ANALYTICS_BINS; b++)
+			rec.hist[b] = w[4 + b];
+		memcpy(rec.probe, &w[4 + ANALYTICS_BINS], sizeof(float) * a->nprobe);
+
+		fprintf(a->log, "%d,%.6g,%.6g,%.6g,%.12g", rec.step, rec.min, rec.max, rec.mean, rec.energy);
+		for (int b = 0; b < ANALYTICS_BINS; b++)
+			fprintf(a->log, ",%u", rec.hist[b]);
+		for (int p = 0; p < a->nprobe; p++)
+			fprintf(a->log, ",%.6g", rec.probe[p]);
+		fprintf(a->log, "\n");
+
+		if (a->recs)
+			a->recs[a->count] = rec;
+		a->count++;
+	}
+	fflush(a->log);
+	a->pending = 0;
+}
+
+// folds the work-group results and probes of temp into the next record slot
+static void finish(struct analytics_dev *a, cl_mem temp, int step)
+{
+	cl_int err;
+	cl_event event = NULL;
+	const size_t local = ANALYTICS_WG * ANALYTICS_WG;
+
+	err =  clSetKernelArg(a->kfinish, 3, sizeof(int),    &a->pending);
+	err |= clSetKernelArg(a->kfinish, 6, sizeof(cl_mem), &temp);
+	checkError(err, "Setting stats_finish args");
+
+	err = clEnqueueNDRangeKernel(a->queue, a->kfinish, 1, NULL, &local, &local,
+		0, NULL, TRACE_EVENT(event));
+	checkError(err, "Enqueueing stats_finish");
+	TRACE_CL(event, "stats_finish", "kernel");
+
+	a->steps[a->pending++] = step;
+	if (a->pending == ANALYTICS_BATCH)
+		flush(a);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to set up device analytics on queue, logging every record to
+//  logname as it is read back and, unless recs is NULL, storing it in recs
+//
+//------------------------------------------------------------------------------
+struct analytics_dev *analytics_dev_create(cl_context context, cl_program program,
+                                           cl_command_queue queue, int ni, int nj, float fact,
+                                           int nprobe, const int *probes,
+                                           const char *logname, struct analytics_rec *recs)
+{
+	cl_int err;
+	struct analytics_dev *a = (struct analytics_dev *)calloc(1, sizeof(struct analytics_dev));
+	int probeIJ[2 * ANALYTICS_MAX_PROBES] = {0};
+
+	if (!a) {
+		fprintf(stderr, "Error: Could not allocate memory for analytics\n");
+		exit(EXIT_FAILURE);
+	}
+
+	a->queue = queue;
+	a->ni = ni;
+	a->nj = nj;
+	a->nprobe = nprobe < ANALYTICS_MAX_PROBES ? nprobe : ANALYTICS_MAX_PROBES;
+	a->recs = recs;
+	memcpy(probeIJ, probes, sizeof(int) * 2 * a->nprobe);
+
+	// one work-item per interior cell, rounded up to whole work-groups
+	a->global[0] = (size_t)(ni - 2 + ANALYTICS_WG - 1) / ANALYTICS_WG * ANALYTICS_WG;
+	a->global[1] = (size_t)(nj - 2 + ANALYTICS_WG - 1) / ANALYTICS_WG * ANALYTICS_WG;
+	a->groups = (int)(a->global[0] / ANALYTICS_WG * (a->global[1] / ANALYTICS_WG));
+
+	a->kfused = clCreateKernel(program, "step_kernel_stats", &err);
+	checkError(err, "Creating step_kernel_stats");
+	a->kfield = clCreateKernel(program, "field_stats", &err);
+	checkError(err, "Creating field_stats");
+	a->kfinish = clCreateKernel(program, "stats_finish", &err);
+	checkError(err, "Creating stats_finish");
+
+	a->partial = clCreateBuffer(context, CL_MEM_READ_WRITE,
+		sizeof(float) * PART_WORDS * a->groups, NULL, &err);
+	checkError(err, "Creating buffer partial");
+	a->phist = clCreateBuffer(context, CL_MEM_READ_WRITE,
+		sizeof(cl_uint) * ANALYTICS_BINS * a->groups, NULL, &err);
+	checkError(err, "Creating buffer phist");
+	a->probes = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		sizeof(probeIJ), probeIJ, &err);
+	checkError(err, "Creating buffer probes");
+	a->records = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+		sizeof(cl_uint) * REC_WORDS * ANALYTICS_BATCH, NULL, &err);
+	checkError(err, "Creating buffer records");
+
+	// everything but the fields and the record slot is fixed
+	err =  clSetKernelArg(a->kfused, 0, sizeof(int),    &ni);
+	err |= clSetKernelArg(a->kfused, 1, sizeof(int),    &nj);
+	err |= clSetKernelArg(a->kfused, 2, sizeof(float),  &fact);
+	err |= clSetKernelArg(a->kfused, 5, sizeof(cl_mem), &a->partial);
+	err |= clSetKernelArg(a->kfused, 6, sizeof(cl_mem), &a->phist);
+	err |= clSetKernelArg(a->kfield, 0, sizeof(int),    &ni);
+	err |= clSetKernelArg(a->kfield, 1, sizeof(int),    &nj);
+	err |= clSetKernelArg(a->kfield, 3, sizeof(cl_mem), &a->partial);
+	err |= clSetKernelArg(a->kfield, 4, sizeof(cl_mem), &a->phist);
+	err |= clSetKernelArg(a->kfinish, 0, sizeof(int),    &ni);
+	err |= clSetKernelArg(a->kfinish, 1, sizeof(int),    &a->groups);
+	err |= clSetKernelArg(a->kfinish, 2, sizeof(int),    &a->nprobe);
+	err |= clSetKernelArg(a->kfinish, 4, sizeof(cl_mem), &a->partial);
+	err |= clSetKernelArg(a->kfinish, 5, sizeof(cl_mem), &a->phist);
+	err |= clSetKernelArg(a->kfinish, 7, sizeof(cl_mem), &a->probes);
+	err |= clSetKernelArg(a->kfinish, 8, sizeof(cl_mem), &a->records);
+	checkError(err, "Setting analytics kernel args");
+
+	a->log = fopen(logname, "w");
+	if (!a->log) {
+		fprintf(stderr, "Error: Could not open %s\n", logname);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(a->log, "step,min,max,mean,energy");
+	for (int b = 0; b < ANALYTICS_BINS; b++)
+		fprintf(a->log, ",bin%d", b);
+	for (int p = 0; p < a->nprobe; p++)
+		fprintf(a->log, ",T_%d_%d", probeIJ[2*p], probeIJ[2*p+1]);
+	fprintf(a->log, "\n");
+
+	return a;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue one device step from temp_in to temp_out that also
+//  summarises the new field, event (if not NULL) is that of the step
+//
+//------------------------------------------------------------------------------
+void analytics_dev_step(struct analytics_dev *a, cl_mem temp_in, cl_mem temp_out,
+                        int step, cl_event *event)
+{
+	cl_int err;
+	const size_t local[2] = {ANALYTICS_WG, ANALYTICS_WG};
+
+	err =  clSetKernelArg(a->kfused, 3, sizeof(cl_mem), &temp_in);
+	err |= clSetKernelArg(a->kfused, 4, sizeof(cl_mem), &temp_out);
+	checkError(err, "Setting step_kernel_stats args");
+
+	err = clEnqueueNDRangeKernel(a->queue, a->kfused, 2, NULL, a->global, local,
+		0, NULL, event);
+	checkError(err, "Enqueueing step_kernel_stats");
+
+	finish(a, temp_out, step);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue a summary of a field already on the device
+//
+//------------------------------------------------------------------------------
+void analytics_dev_field(struct analytics_dev *a, cl_mem temp, int step)
+{
+	cl_int err;
+	cl_event event = NULL;
+	const size_t local[2] = {ANALYTICS_WG, ANALYTICS_WG};
+
+	err = clSetKernelArg(a->kfield, 2, sizeof(cl_mem), &temp);
+	checkError(err, "Setting field_stats args");
+
+	err = clEnqueueNDRangeKernel(a->queue, a->kfield, 2, NULL, a->global, local,
+		0, NULL, TRACE_EVENT(event));
+	checkError(err, "Enqueueing field_stats");
+	TRACE_CL(event, "field_stats", "kernel");
+
+	finish(a, temp, step);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to read back the remaining records, close the log and release
+//  the device objects. Returns the number of records taken.
+//
+//------------------------------------------------------------------------------
+int analytics_dev_close(struct analytics_dev *a)
+{
+	int count;
+
+	flush(a);
+	fclose(a->log);
+	count = a->count;
+
+	clReleaseMemObject(a->partial);
+	clReleaseMemObject(a->phist);
+	clReleaseMemObject(a->probes);
+	clReleaseMemObject(a->records);
+	clReleaseKernel(a->kfused);
+	clReleaseKernel(a->kfield);
+	clReleaseKernel(a->kfinish);
+	free(a);
+
+	return count;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compare n records with those of the host and output results
+//
+//------------------------------------------------------------------------------
+void analytics_compare(int n, const struct analytics_rec *recs,
+                       const struct analytics_rec *ref, int nprobe)
+{
+	float maxDiff = 0;      // of min, max, mean and probes
+	double maxEnergy = 0;   // relative
+	long binned = 0;        // cells counted in another bin than on the host
+
+	for (int k = 0; k < n; k++) {
+		const struct analytics_rec *r = &recs[k], *h = &ref[k];
+
+		maxDiff = fmaxf(maxDiff, fabsf(r->min - h->min));
+		maxDiff = fmaxf(maxDiff, fabsf(r->max - h->max));
+		maxDiff = fmaxf(maxDiff, (float)fabs(r->mean - h->mean));
+		for (int p = 0; p < nprobe; p++)
+			maxDiff = fmaxf(maxDiff, fabsf(r->probe[p] - h->probe[p]));
+		if (h->energy != 0)
+			maxEnergy = fmax(maxEnergy, fabs(r->energy - h->energy) / fabs(h->energy));
+
+		long moved = 0;
+		for (int b = 0; b < ANALYTICS_BINS; b++)
+			moved += labs((long)r->hist[b] - (long)h->hist[b]);
+		binned += moved / 2;
+	}
+
+	printf("Analytics: %d records, max difference %.5f, relative energy difference %.3e, %ld cells binned differently.\n",
+		n, maxDiff, maxEnergy, binned);
+
+	if (maxDiff > TOL)
+		printf("The analytics differ from the host by more than %.5f.\n", TOL);
+	else
+		printf("The analytics agree with the host.\n");
+}
@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: In-situ analytics include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __ANALYTICS_HDR
+#define __ANALYTICS_HDR
+
+// the STATS_* constants in C_heat_conduction.cl must match these
+#define ANALYTICS_BINS        16       // histogram bins
+#define ANALYTICS_MAX_PROBES  8        // probe points recorded per sample
+#define ANALYTICS_T_MIN       0.0f     // histogram range, that of initmat
+#define ANALYTICS_T_MAX       100.0f
+#define ANALYTICS_WG          16       // work-groups are ANALYTICS_WG x ANALYTICS_WG
+#define ANALYTICS_BATCH       64       // records kept on the device between readbacks
+
+//------------------------------------------------------------------------------
+//
+//  Summary of the interior cells of one field
+//
+//------------------------------------------------------------------------------
+struct analytics_rec {
+	int          step;
+	float        min, max;
+	double       mean;
+	double       energy;                        // sum of temperatures, in rho c dV
+	unsigned int hist[ANALYTICS_BINS];          // cells per bin of [T_MIN, T_MAX]
+	float        probe[ANALYTICS_MAX_PROBES];   // temperature at each probe point
+};
+
+struct analytics_dev;
+
+//------------------------------------------------------------------------------
+//
+//  Function to summarise the interior of a field on the host. probes holds
+//  nprobe (i, j) pairs.
+//
+//------------------------------------------------------------------------------
+void analytics_field_ref(int ni, int nj, const float *temp,
+                         int nprobe, const int *probes, struct analytics_rec *rec);
+
+//------------------------------------------------------------------------------
+//
+//  Function to run one host step and summarise the new field in the same pass
+//
+//------------------------------------------------------------------------------
+void analytics_step_ref(int ni, int nj, float fact, const float *temp_in, float *temp_out,
+                        int nprobe, const int *probes, struct analytics_rec *rec);
+
+//------------------------------------------------------------------------------
+//
+//  Function to set up device analytics on queue, logging every record to
+//  logname as it is read back and, unless recs is NULL, storing it in recs
+//
+//------------------------------------------------------------------------------
+struct analytics_dev *analytics_dev_create(cl_context context, cl_program program,
+                                           cl_command_queue queue, int ni, int nj, float fact,
+                                           int nprobe, const int *probes,
+                                           const char *logname, struct analytics_rec *recs);
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue one device step from temp_in to temp_out that also
+//  summarises the new field, event (if not NULL) is that of the step
+//
+//------------------------------------------------------------------------------
+void analytics_dev_step(struct analytics_dev *a, cl_mem temp_in, cl_mem temp_out,
+                        int step, cl_event *event);
+
+//------------------------------------------------------------------------------
+//
+//  Function to enqueue a summary of a field already on the device
+//
+//------------------------------------------------------------------------------
+void analytics_dev_field(struct analytics_dev *a, cl_mem temp, int step);
+
+//------------------------------------------------------------------------------
+//
+//  Function to read back the remaining records, close the log and release
+//  the device objects. Returns the number of records taken.
+//
+//------------------------------------------------------------------------------
+int analytics_dev_close(struct analytics_dev *a);
+
+//------------------------------------------------------------------------------
+//
+//  Function to compare n records with those of the host and output results
+//
+//------------------------------------------------------------------------------
+void analytics_compare(int n, const struct analytics_rec *recs,
+                       const struct analytics_rec *ref, int nprobe);
+
+#endif
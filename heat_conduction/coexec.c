@@ -0,0 +1,194 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: CPU + OpenCL co-execution with dynamic load balancing
+//
+//  PURPOSE: Every step the host computes rows 1 to split-1 with the reference
+//           stencil while the device computes rows split to nj-2 with
+//           step_kernel_mod. Each side keeps a full copy of both fields and
+//           only the rows the other side needs next are copied across, which
+//           is a single halo row each way while the split stays put.
+//           The copies do not block: the write is ordered before the kernel
+//           on the queue and the host only waits for the rows it reads.
+//           The split follows the measured rows per second of each side,
+//           the device side counting its halo transfers as well as the kernel.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include "heat_sim.h"
+#include "coexec.h"
+
+#define COEXEC_DAMPING 0.5   // weight of the newest measurement in the split
+
+// enqueues a copy of rows j0 to j1-1 between a host field and a device buffer
+// without waiting for it, event is NULL if there is nothing to copy
+static void copy_rows(cl_command_queue queue, cl_mem buffer, float *field,
+                      int ni, int j0, int j1, bool toDevice, cl_event *event)
+{
+	cl_int err;
+	size_t offset = sizeof(float) * I2D(ni, 0, j0);
+	size_t bytes = sizeof(float) * ni * (j1 - j0);
+
+	*event = NULL;
+	if (j1 <= j0)
+		return;
+
+	if (toDevice)
+		err = clEnqueueWriteBuffer(queue, buffer, CL_FALSE, offset, bytes, field + I2D(ni, 0, j0),
+			0, NULL, event);
+	else
+		err = clEnqueueReadBuffer(queue, buffer, CL_FALSE, offset, bytes, field + I2D(ni, 0, j0),
+			0, NULL, event);
+	checkError(err, "Exchanging rows");
+}
+
+// waits for a command and returns its device time in seconds, the event is
+// recorded when tracing and released
+static double event_time(cl_event event, const char *name, const char *cat)
+{
+	cl_int err;
+	cl_ulong evStart, evEnd;
+
+	if (!event)
+		return 0;
+
+	err = clWaitForEvents(1, &event);
+	checkError(err, "Waiting for co-execution command");
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &evStart, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &evEnd, NULL);
+	if (trace_on)
+		trace_cl_event(name, cat, TRACE_TRACK_QUEUE, event);
+	else
+		clReleaseEvent(event);
+
+	return (evEnd - evStart) * 1e-9;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run tSteps steps with each step's rows split between the host
+//  and the device, the host taking the top rows. cpuShare is the initial
+//  fraction of rows given to the host, later steps re-balance it from the
+//  measured times. Returns whichever of temp_in and temp_out holds the result.
+//
+//------------------------------------------------------------------------------
+float *coexec_run(cl_context context, cl_device_id device, cl_program program,
+                  int ni, int nj, float fact, int tSteps, float cpuShare,
+                  float *temp_in, float *temp_out, struct coexec_stats *st)
+{
+	cl_int err;
+	cl_mem d_in, d_out, d_tmp;
+	float *tmp;
+	int rows = nj - 2;        // interior rows shared out every step
+
+	memset(st, 0, sizeof(*st));
+	if (rows < 2) {
+		printf("Co-execution needs at least 2 interior rows\n");
+		return temp_in;
+	}
+
+	// own profiling queue, the device time is read from its events
+	cl_command_queue queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
+	checkError(err, "Creating co-execution queue");
+	cl_kernel kernel = clCreateKernel(program, "step_kernel_mod", &err);
+	checkError(err, "Creating co-execution kernel");
+
+	d_in = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+		sizeof(float) * ni * nj, temp_in, &err);
+	checkError(err, "Creating buffer d_in");
+	d_out = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+		sizeof(float) * ni * nj, temp_out, &err);
+	checkError(err, "Creating buffer d_out");
+
+	err =  clSetKernelArg(kernel, 0, sizeof(int),   &ni);
+	err |= clSetKernelArg(kernel, 1, sizeof(int),   &nj);
+	err |= clSetKernelArg(kernel, 2, sizeof(float), &fact);
+	checkError(err, "Setting co-execution kernel args");
+
+	// rows of temp_in valid on the host are [0, hostTo), on the device [devFrom, nj)
+	int hostTo = nj, devFrom = 0;
+	double cpuRows = cpuShare * rows;
+	int split = 1;
+
+	double start = wtime();
+
+	for (int t = 0; t < tSteps; t++) {
+		cl_event evRead = NULL, evWrite = NULL, evRun;
+
+		// host computes rows [1, split), device rows [split, nj-1)
+		split = 1 + (int)(cpuRows + 0.5);
+		if (split < 2) split = 2;
+		if (split > nj - 2) split = nj - 2;
+
+		// bring each side up to date with the rows it now reads
+		if (split + 1 > hostTo) {
+			copy_rows(queue, d_in, temp_in, ni, hostTo, split + 1, 0, &evRead);
+			hostTo = split + 1;
+		}
+		if (split - 1 < devFrom) {
+			copy_rows(queue, d_in, temp_in, ni, split - 1, devFrom, 1, &evWrite);
+			devFrom = split - 1;
+		}
+
+		err =  clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_in);
+		err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &d_out);
+		checkError(err, "Setting co-execution kernel args");
+
+		// the kernel adds 1 to the global id, so offset by split-1
+		const size_t offset[2] = {0, split - 1};
+		const size_t global[2] = {ni - 1, nj - 1 - split};
+		err = clEnqueueNDRangeKernel(queue, kernel, 2, offset, global, NULL, 0, NULL, &evRun);
+		checkError(err, "Enqueueing co-execution kernel");
+		clFlush(queue);
+
+		// the host rows only need the halo read back, not the kernel
+		double xferTime = event_time(evRead, "read halo", "transfer");
+
+		double cpuStart = wtime();
+		step_kernel_band(ni, nj, 1, split, fact, temp_in, temp_out);
+		double cpuTime = wtime() - cpuStart;
+
+		double devTime = event_time(evRun, "co-exec kernel", "kernel");
+		xferTime += event_time(evWrite, "write halo", "transfer");
+		devTime += xferTime;
+
+		st->cpuTime += cpuTime;
+		st->devTime += devTime;
+		st->xferTime += xferTime;
+
+		// move the split so both sides would have taken equally long
+		if (cpuTime > 0 && devTime > 0) {
+			double cpuRate = (split - 1) / cpuTime;
+			double devRate = (nj - 1 - split) / devTime;
+			double target = rows * cpuRate / (cpuRate + devRate);
+			cpuRows = (1 - COEXEC_DAMPING) * cpuRows + COEXEC_DAMPING * target;
+		}
+
+		// the new field is valid up to split on the host, from split on the device
+		hostTo = split;
+		devFrom = split;
+
+		tmp = temp_in;
+		temp_in = temp_out;
+		temp_out = tmp;
+		d_tmp = d_in;
+		d_in = d_out;
+		d_out = d_tmp;
+	}
+
+	// gather the device rows
+	cl_event evGather;
+	copy_rows(queue, d_in, temp_in, ni, hostTo, nj, 0, &evGather);
+	event_time(evGather, "read rows", "transfer");
+
+	st->runTime = wtime() - start;
+	st->cpuRows = split - 1;
+
+	clReleaseMemObject(d_in);
+	clReleaseMemObject(d_out);
+	clReleaseKernel(kernel);
+	clReleaseCommandQueue(queue);
+
+	return temp_in;
+}
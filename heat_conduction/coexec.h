@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: CPU + OpenCL co-execution include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __COEXEC_HDR
+#define __COEXEC_HDR
+
+//------------------------------------------------------------------------------
+//
+//  Results of a co-executed run
+//
+//------------------------------------------------------------------------------
+struct coexec_stats {
+	double runTime;     // wall time of the whole run, seconds
+	double cpuTime;     // time the host spent computing its rows, seconds
+	double devTime;     // kernel and halo transfer time on the device, seconds
+	double xferTime;    // the part of devTime spent on halo transfers, seconds
+	int    cpuRows;     // rows computed on the host in the last step
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to run tSteps steps with each step's rows split between the host
+//  and the device, the host taking the top rows. cpuShare is the initial
+//  fraction of rows given to the host, later steps re-balance it from the
+//  measured times. Returns whichever of temp_in and temp_out holds the result.
+//
+//------------------------------------------------------------------------------
+float *coexec_run(cl_context context, cl_device_id device, cl_program program,
+                  int ni, int nj, float fact, int tSteps, float cpuShare,
+                  float *temp_in, float *temp_out, struct coexec_stats *st);
+
+#endif
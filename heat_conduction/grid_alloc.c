@@ -0,0 +1,241 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: NUMA aware, huge page backed grid allocation
+//
+//  PURPOSE: Grids are mapped directly with mmap so no page is touched before
+//           the placement policy and page size are set. NUMA policy is set
+//           with the mbind system call, so libnuma is not needed. On systems
+//           without these (or with a single node) everything degrades to a
+//           plain allocation that is still first touched in parallel.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include "heat_sim.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define GRID_HEADER          64  // bytes in front of each grid, a cache line
+#define MPOL_BIND_MODE       2   // values of the kernel's MPOL_* constants
+#define MPOL_INTERLEAVE_MODE 3
+
+// kept in front of each grid, so grid_free knows how it was allocated
+struct grid_header {
+	void  *base;     // start of the mapping or allocation
+	size_t len;
+	bool   mapped;   // mmap, otherwise malloc
+};
+
+static void warn_once(bool *warned, const char *msg)
+{
+	if (!*warned)
+		fprintf(stderr, "Warning: %s\n", msg);
+	*warned = 1;
+}
+
+// parses a sysfs list such as "0-3,8-11" into values, returns the count
+static int parse_list(const char *path, int *vals, int maxVals)
+{
+	char line[4096];
+	int n = 0;
+	FILE *file = fopen(path, "r");
+
+	if (!file)
+		return 0;
+	if (!fgets(line, sizeof(line), file))
+		line[0] = '\0';
+	fclose(file);
+
+	for (char *p = line; *p && *p != '\n'; ) {
+		char *next;
+		long lo = strtol(p, &next, 10), hi = lo;
+		if (next == p)
+			break;
+		if (*next == '-')
+			hi = strtol(next + 1, &next, 10);
+		for (long v = lo; v <= hi && n < maxVals; v++)
+			vals[n++] = (int)v;
+		p = *next == ',' ? next + 1 : next;
+	}
+	return n;
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+static int set_policy(void *addr, size_t len, int mode, unsigned long mask)
+{
+	// maxnode is one past the highest node bit, the kernel drops the last one
+	return syscall(SYS_mbind, addr, len, mode, &mask, 8 * sizeof(mask) + 1, 0) == 0 ? SUCCESS : FAILURE;
+}
+#else
+static int set_policy(void *addr, size_t len, int mode, unsigned long mask)
+{
+	return FAILURE;
+}
+#endif
+
+//------------------------------------------------------------------------------
+//
+//  Function to count NUMA nodes, 1 where NUMA is not available
+//
+//------------------------------------------------------------------------------
+int grid_numa_nodes(void)
+{
+	int nodes[64];
+	int n = parse_list("/sys/devices/system/node/online", nodes, 64);
+	return n > 0 ? nodes[n-1] + 1 : 1;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to list the CPUs of a NUMA node, returns how many were written
+//
+//------------------------------------------------------------------------------
+int grid_node_cpus(int node, int *cpus, int maxCpus)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	return parse_list(path, cpus, maxCpus);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to pin the calling thread to one CPU
+//
+//------------------------------------------------------------------------------
+int grid_pin_thread(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0 ? SUCCESS : FAILURE;
+#else
+	return FAILURE;
+#endif
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to allocate an ni x nj grid of zeros. The interior rows are first
+//  touched in parallel with the same static row split as step_kernel_band,
+//  so with GRID_FIRST_TOUCH each page lands on the node of the thread that
+//  will compute it. NUMA and huge page requests that the system cannot honour
+//  are dropped with a warning.
+//
+//------------------------------------------------------------------------------
+float *grid_alloc(int ni, int nj, const struct grid_opts *opts)
+{
+	static bool warnedHuge, warnedNuma;
+	size_t bytes = GRID_HEADER + sizeof(float) * ni * nj;
+	void *base = NULL;
+	size_t len = 0;
+	bool mapped = 0;
+	float *grid;
+	struct grid_header *head;
+
+#ifdef __linux__
+	// explicit huge pages, only if the administrator reserved some
+	if (opts->pages == GRID_PAGES_HUGETLB) {
+		len = (bytes + GRID_HUGE_PAGE - 1) & ~(GRID_HUGE_PAGE - 1);
+		base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (base == MAP_FAILED) {
+			base = NULL;
+			warn_once(&warnedHuge, "no explicit huge pages available, using transparent huge pages");
+		}
+	}
+
+	// normal pages, aligned to a huge page so THP can back the whole grid
+	if (!base) {
+		len = (bytes + GRID_HUGE_PAGE - 1) & ~(GRID_HUGE_PAGE - 1);
+		size_t span = len + GRID_HUGE_PAGE;
+		char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw != MAP_FAILED) {
+			char *aligned = (char *)(((uintptr_t)raw + GRID_HUGE_PAGE - 1) & ~(uintptr_t)(GRID_HUGE_PAGE - 1));
+			if (aligned > raw)
+				munmap(raw, aligned - raw);
+			if (aligned + len < raw + span)
+				munmap(aligned + len, raw + span - (aligned + len));
+			base = aligned;
+
+#ifdef MADV_HUGEPAGE
+			if (opts->pages != GRID_PAGES_DEFAULT && madvise(base, len, MADV_HUGEPAGE) != 0)
+				warn_once(&warnedHuge, "transparent huge pages not available");
+#endif
+		}
+	}
+	mapped = base != NULL;
+#endif
+
+	// anything else, NUMA and huge page options do not apply
+	if (!base) {
+		len = bytes;
+		base = malloc(len);
+		if (!base) {
+			fprintf(stderr, "Error: Could not allocate memory for grid\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// policy has to be in place before the first touch below
+	if (opts->placement != GRID_FIRST_TOUCH) {
+		int nodes = grid_numa_nodes();
+		int maxNodes = 8 * sizeof(unsigned long);
+		int status = FAILURE;
+
+		if (mapped && nodes > 1 && nodes <= maxNodes) {
+			unsigned long all = nodes == maxNodes ? ~0UL : (1UL << nodes) - 1;
+			if (opts->placement == GRID_INTERLEAVE)
+				status = set_policy(base, len, MPOL_INTERLEAVE_MODE, all);
+			else if (opts->node >= 0 && opts->node < nodes)
+				status = set_policy(base, len, MPOL_BIND_MODE, 1UL << opts->node);
+		}
+
+		if (status != SUCCESS)
+			warn_once(&warnedNuma, "NUMA placement not available, using first touch");
+	}
+
+	head = (struct grid_header *)base;
+	head->base = base;
+	head->len = len;
+	head->mapped = mapped;
+	grid = (float *)((char *)base + GRID_HEADER);
+
+	// first touch, same partitioning as the compute loops
+	memset(grid, 0, sizeof(float) * ni);
+	#pragma omp parallel for schedule(static)
+	for (int j = 1; j < nj-1; j++)
+		memset(grid + I2D(ni, 0, j), 0, sizeof(float) * ni);
+	if (nj > 1)
+		memset(grid + I2D(ni, 0, nj-1), 0, sizeof(float) * ni);
+
+	return grid;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to free a grid from grid_alloc
+//
+//------------------------------------------------------------------------------
+void grid_free(float *grid)
+{
+	if (!grid)
+		return;
+
+	struct grid_header head = *(struct grid_header *)((char *)grid - GRID_HEADER);
+#ifdef __linux__
+	if (head.mapped)
+		munmap(head.base, head.len);
+	else
+#endif
+		free(head.base);
+}
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Grid allocator include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __GRID_ALLOC_HDR
+#define __GRID_ALLOC_HDR
+
+#define GRID_HUGE_PAGE   (2UL << 20)   // huge page size assumed, 2 MB
+
+// where the pages of a grid are placed
+#define GRID_FIRST_TOUCH 0   // on the node of the thread computing those rows
+#define GRID_INTERLEAVE  1   // round robin over all nodes
+#define GRID_BIND        2   // all on one node
+
+// page size used for a grid
+#define GRID_PAGES_DEFAULT  0   // whatever the system does by default
+#define GRID_PAGES_THP      1   // ask for transparent huge pages
+#define GRID_PAGES_HUGETLB  2   // explicit huge pages, falls back to THP
+
+//------------------------------------------------------------------------------
+//
+//  Placement options, zero initialised means first touch and default pages
+//
+//------------------------------------------------------------------------------
+struct grid_opts {
+	int placement;
+	int node;      // node for GRID_BIND
+	int pages;
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to allocate an ni x nj grid of zeros. The interior rows are first
+//  touched in parallel with the same static row split as step_kernel_band,
+//  so with GRID_FIRST_TOUCH each page lands on the node of the thread that
+//  will compute it. NUMA and huge page requests that the system cannot honour
+//  are dropped with a warning.
+//
+//------------------------------------------------------------------------------
+float *grid_alloc(int ni, int nj, const struct grid_opts *opts);
+
+//------------------------------------------------------------------------------
+//
+//  Function to free a grid from grid_alloc
+//
+//------------------------------------------------------------------------------
+void grid_free(float *grid);
+
+//------------------------------------------------------------------------------
+//
+//  Function to count NUMA nodes, 1 where NUMA is not available
+//
+//------------------------------------------------------------------------------
+int grid_numa_nodes(void);
+
+//------------------------------------------------------------------------------
+//
+//  Function to list the CPUs of a NUMA node, returns how many were written
+//
+//------------------------------------------------------------------------------
+int grid_node_cpus(int node, int *cpus, int maxCpus);
+
+//------------------------------------------------------------------------------
+//
+//  Function to pin the calling thread to one CPU
+//
+//------------------------------------------------------------------------------
+int grid_pin_thread(int cpu);
+
+#endif
@@ -10,12 +10,13 @@ int main(int argc, char *argv[])
     float *temp1_ref, *temp2_ref, *temp; // reference matrices in host memory
 	float *temp_out;			  // host output matrix for GPU
 	
-    int size;               // number of elements in each matrix
+    size_t size;            // number of elements in each matrix
 
     cl_mem temp1, temp2, temp_tmp;   // matrices in device memory
 
     double start_time;      // starting time
     double run_time;        // run time
+    double cpu_time;        // run time of the host version
 	float transfer;
 	float tfac = 8.418e-5; // thermal diffusivity of silver
 
@@ -27,11 +28,45 @@ int main(int argc, char *argv[])
     cl_command_queue commands;      // compute command queue
     cl_program       program;       // compute program
     cl_kernel        kernel;        // compute kernel
+    cl_kernel        ksum;          // row checksum kernel
 
     int ni = WIDTH;
 	int nj = HEIGHT;
 	int tSteps = COUNT;
 	bool saveData = 0;
+	bool saveSnap = 0;      // save compressed frames to heat_con.snap
+	float snapError = 0;    // error bound of the saved frames, 0 is lossless
+	struct snap_writer *snap = NULL;
+	float *snap_first = NULL;   // first frame saved, to check the round trip
+	int valStride = 1;      // validate every valStride-th row and column
+	bool valChecksum = 0;   // validate with on-device row checksums
+	cl_event event = NULL;  // profiling event, only requested when tracing
+	bool specialize = 0;    // bake ni, nj and tfac into the kernels
+	char options[256] = ""; // program build options
+	const char *kernelName = "step_kernel_mod";
+	bool coExec = 0;        // also run split between host and device
+	float *co_in = NULL, *co_out = NULL;   // initial fields for co-execution
+	struct grid_opts gridOpts = {GRID_FIRST_TOUCH, 0, GRID_PAGES_DEFAULT};
+	cl_uint bufArg = 3;     // index of the first buffer argument of the kernel
+	bool streamDev = 0;     // stream bands through the device, fields stay on the host
+	int streamRows = 0;     // rows per streamed band, 0 sizes them to the device
+	int streamSteps = 15;   // steps per streamed band per pass
+	const char *fieldFile = NULL;   // map the host fields from this file
+	float *fields = NULL;   // the mapping, or NULL
+	int fieldCount = 3;     // fields in the mapping
+	float *stream_other = NULL;     // second host field of the streamed run
+	int statsEvery = 0;     // summarise the field every statsEvery steps, 0 never
+	int nprobe = 0;         // probe points, as (i, j) pairs
+	int probes[2 * ANALYTICS_MAX_PROBES];
+	struct analytics_rec *hostRecs = NULL, *devRecs = NULL;
+	int nRecs = 0;          // host records taken
+	struct analytics_dev *stats = NULL;
+	int renderEvery = 0;    // render a frame every renderEvery steps, 0 never
+	int renderScale = 0;    // cells per pixel edge, 0 picks one
+	int imageW = 0, imageH = 0;
+	unsigned char *image = NULL, *image_ref = NULL;
+	struct render_dev *renderer = NULL;
+	struct gif_writer *gif = NULL;
 	
 //--------------------------------------------------------------------------------
 // Check flags for custom input and allocate memory
@@ -44,6 +79,27 @@ int main(int argc, char *argv[])
 			printf("      -mH= MatHeight (Height of matrices, default 320)\n");
 			printf("      -tS= TimeSteps (Number of time steps, default 30)\n");
 			printf("      -sF (Save numeric data to heat_con.csv)\n");
+			printf("      -sZ (Save compressed frames to heat_con.snap, read with snap_extract)\n");
+			printf("      -sL= ErrorBound (Save frames to heat_con.snap within ErrorBound)\n");
+			printf("      -sK (Specialise kernels for the matrix size, built once and cached in %s)\n",
+				PROGRAM_CACHE_DIR);
+			printf("      -vS= Stride (Validate every Stride-th row and column against the closed-form solution, default 1)\n");
+			printf("      -vC (Validate with on-device row checksums against the closed-form solution, no field readback)\n");
+			printf("      -nI (Interleave host matrices over all NUMA nodes)\n");
+			printf("      -nB= Node (Bind host matrices to NUMA node Node)\n");
+			printf("      -hT (Back host matrices with transparent 2 MB huge pages)\n");
+			printf("      -hE (Back host matrices with explicit 2 MB huge pages)\n");
+			printf("      -cE (Also run each step split between CPU and device, load balanced)\n");
+			printf("      -oS (Stream row bands through the device, for fields larger than its memory)\n");
+			printf("      -oB= Rows (Rows per streamed band, default sized to device memory)\n");
+			printf("      -oK= Steps (Steps per streamed band per pass, odd, default 15)\n");
+			printf("      -oF= File (Map the host matrices from File, for fields larger than memory)\n");
+			printf("      -aN= Steps (Save min, max, mean, energy, histogram and probes every Steps steps to heat_stats.csv)\n");
+			printf("      -aP= i,j (Add a probe point, up to %d, default the centre)\n", ANALYTICS_MAX_PROBES);
+			printf("      -rN= Steps (Render a frame every Steps steps to heat_con.gif)\n");
+			printf("      -rS= Scale (Average Scale x Scale cells per pixel, default keeps frames within %d pixels)\n",
+				RENDER_MAX_SIZE);
+			printf("      --trace=File (Write a Chrome trace of all phases to File)\n");
 
 			return 0;
 		}
@@ -52,13 +108,95 @@ int main(int argc, char *argv[])
 		if (strcmp(argv[i], "-mH=") == 0) nj = atoi(argv[i+1]);
 		if (strcmp(argv[i], "-tS=") == 0) tSteps = atoi(argv[i+1]);
 		if (strcmp(argv[i], "-sF") == 0) saveData = 1;
+		if (strcmp(argv[i], "-sK") == 0) specialize = 1;
+		if (strcmp(argv[i], "-sZ") == 0) saveSnap = 1;
+		if (strcmp(argv[i], "-cE") == 0) coExec = 1;
+		if (strcmp(argv[i], "-nI") == 0) gridOpts.placement = GRID_INTERLEAVE;
+		if (strcmp(argv[i], "-nB=") == 0) {
+			gridOpts.placement = GRID_BIND;
+			gridOpts.node = atoi(argv[i+1]);
+		}
+		if (strcmp(argv[i], "-hT") == 0) gridOpts.pages = GRID_PAGES_THP;
+		if (strcmp(argv[i], "-hE") == 0) gridOpts.pages = GRID_PAGES_HUGETLB;
+		if (strcmp(argv[i], "-sL=") == 0) {
+			saveSnap = 1;
+			snapError = atof(argv[i+1]);
+		}
+		if (strcmp(argv[i], "-vS=") == 0) valStride = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-vC") == 0) valChecksum = 1;
+		if (strcmp(argv[i], "-oS") == 0) streamDev = 1;
+		if (strcmp(argv[i], "-oB=") == 0) streamRows = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-oK=") == 0) streamSteps = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-oF=") == 0) fieldFile = argv[i+1];
+		if (strcmp(argv[i], "-rN=") == 0) renderEvery = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-rS=") == 0) renderScale = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-aN=") == 0) statsEvery = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-aP=") == 0 && nprobe < ANALYTICS_MAX_PROBES &&
+			sscanf(argv[i+1], "%d,%d", &probes[2*nprobe], &probes[2*nprobe+1]) == 2) nprobe++;
+		if (strncmp(argv[i], "--trace=", 8) == 0) trace_open(argv[i] + 8);
+	}
+	
+	if (valStride < 1) valStride = 1;
+
+	// sampled and checksum validation start from a field known in closed form,
+	// the host run is only made for the features that need its fields
+	bool closedForm = valChecksum || valStride > 1;
+	bool hostRun = !closedForm || saveData || saveSnap || statsEvery > 0 || coExec ||
+	               (renderEvery > 0 && !streamDev);
+
+	if (statsEvery > 0) {
+		// drop probes outside the field
+		int kept = 0;
+		for (int p = 0; p < nprobe; p++) {
+			if (probes[2*p] < 0 || probes[2*p] >= ni || probes[2*p+1] < 0 || probes[2*p+1] >= nj) {
+				fprintf(stderr, "Warning: probe (%d, %d) is outside the field, ignored\n",
+					probes[2*p], probes[2*p+1]);
+				continue;
+			}
+			probes[2*kept] = probes[2*p];
+			probes[2*kept+1] = probes[2*p+1];
+			kept++;
+		}
+		nprobe = kept;
+		if (nprobe == 0) {
+			probes[0] = ni / 2;
+			probes[1] = nj / 2;
+			nprobe = 1;
+		}
+
+		hostRecs = (struct analytics_rec *)calloc(tSteps / statsEvery + 1, sizeof(struct analytics_rec));
+		devRecs = (struct analytics_rec *)calloc(tSteps / statsEvery + 1, sizeof(struct analytics_rec));
+	}
+
+	if (renderEvery > 0) {
+		if (renderScale < 1) renderScale = render_scale(ni, nj);
+		render_size(ni, nj, renderScale, &imageW, &imageH);
+		image = (unsigned char *)malloc((size_t)imageW * imageH);
+		image_ref = (unsigned char *)malloc((size_t)imageW * imageH);
 	}
 	
-	size = ni * nj;
+	size = (size_t)ni * nj;
 
-    temp1_ref = (float *)malloc(size * sizeof(float));
-    temp2_ref = (float *)malloc(size * sizeof(float));
-	temp_out = (float *)malloc(size * sizeof(float));
+	// the whole-field kernels index with int, only streamed bands go beyond
+	if (size > INT_MAX && !streamDev) {
+		fprintf(stderr, "Error: %d x %d cells need streaming through the device (-oS)\n", ni, nj);
+		exit(EXIT_FAILURE);
+	}
+
+	if (fieldFile) {
+		// paged in and out by the kernel, only the bands in use stay resident
+		if (streamDev) fieldCount = 4;
+		fields = stream_map(fieldFile, ni, nj, fieldCount);
+		temp1_ref = fields;
+		temp2_ref = fields + size;
+		temp_out = fields + size * 2;
+	}
+	else {
+		// placed and first touched to suit the threaded host stencil
+		temp1_ref = grid_alloc(ni, nj, &gridOpts);
+		temp2_ref = grid_alloc(ni, nj, &gridOpts);
+		temp_out = grid_alloc(ni, nj, &gridOpts);
+	}
 	
 	transfer = 2 * sizeof(float) * size / 1024;
 	
@@ -66,6 +204,8 @@ int main(int argc, char *argv[])
 // Create a context, queue and device
 //--------------------------------------------------------------------------------
 
+    TRACE_BEGIN(t_setup);
+
     cl_uint deviceIndex = 0;
     parseArguments(argc, argv, &deviceIndex);
 
@@ -90,34 +230,75 @@ int main(int argc, char *argv[])
     context = clCreateContext(0, 1, &device, NULL, NULL, &err);
     checkError(err, "Creating context");
 
-    // Create a command queue
-    commands = clCreateCommandQueue(context, device, 0, &err);
+    // Create a command queue, with event profiling only when tracing
+    commands = clCreateCommandQueue(context, device,
+                            trace_on ? CL_QUEUE_PROFILING_ENABLE : 0, &err);
     checkError(err, "Creating command queue");
 
+    TRACE_END(t_setup, "setup device", "host");
+
 //--------------------------------------------------------------------------------
 // Initialise matrices, setup the buffers and write them into global memory
 //--------------------------------------------------------------------------------
-	initmat(size, temp1_ref, temp_out, temp2_ref);
+    TRACE_BEGIN(t_init);
+
+	if (closedForm)
+		initmat_mode(ni, nj, temp1_ref, temp_out, temp2_ref);
+	else
+		initmat(size, temp1_ref, temp_out, temp2_ref);
+
+	if (coExec) {
+		co_in = grid_alloc(ni, nj, &gridOpts);
+		co_out = grid_alloc(ni, nj, &gridOpts);
+		memcpy(co_in, temp_out, size * sizeof(float));
+		memcpy(co_out, temp2_ref, size * sizeof(float));
+	}
 	
-    temp1 = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                            sizeof(float) * size, temp_out, &err);
-    checkError(err, "Creating buffer temp1");
-    temp2 = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                            sizeof(float) * size, temp2_ref, &err);
-    checkError(err, "Creating buffer temp2");
+	if (streamDev) {
+		// the streamed run works on temp_out and a copy of the second field
+		stream_other = fields ? fields + size * 3 : grid_alloc(ni, nj, &gridOpts);
+		memcpy(stream_other, temp2_ref, size * sizeof(float));
+	}
+	else {
+		temp1 = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+		                        sizeof(float) * size, temp_out, &err);
+		checkError(err, "Creating buffer temp1");
+		temp2 = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+		                        sizeof(float) * size, temp2_ref, &err);
+		checkError(err, "Creating buffer temp2");
+	}
+
+    TRACE_END(t_init, "init buffers", "host");
 	
 //--------------------------------------------------------------------------------
 // Run host reference version
 //--------------------------------------------------------------------------------
-    printf("\n===== Executing %d times host CPU version, order %d x %d ======\n", tSteps, ni, nj);
+	if (hostRun)
+		printf("\n===== Executing %d times host CPU version, order %d x %d ======\n", tSteps, ni, nj);
+	else
+		printf("\n===== Host CPU version skipped, validating against the closed-form solution ======\n");
 	
 	//remove previous file
 	if(saveData == 1) remove("heat_con.csv");
+	if(saveSnap == 1) {
+		snap = snap_create("heat_con.snap", ni, nj, snapError);
+		snap_first = (float *)malloc(sizeof(float) * size);
+	}
+	if(renderEvery > 0) gif = gif_open("heat_con.gif", imageW, imageH);
 	
 	start_time = wtime();
 	
-    for (int i = 0; i < tSteps; i++) {
-		if(saveData == 0)
+    for (int i = 0; hostRun && i < tSteps; i++) {
+		bool sample = statsEvery > 0 && (i + 1) % statsEvery == 0;
+		bool fused = sample && saveData == 0 && !fields;
+
+		if(fused)
+			analytics_step_ref(ni, nj, tfac, temp1_ref, temp2_ref, nprobe, probes, &hostRecs[nRecs]);
+		else if(saveData == 0 && fields)
+			stream_step_host(ni, nj, tfac, STREAM_HOST_BAND / ni, 1, temp1_ref, temp2_ref);
+		else if(saveData == 0 && specialize == 1)
+			step_kernel_ref_spec(ni, nj, tfac, temp1_ref, temp2_ref);
+		else if(saveData == 0)
 			step_kernel_ref(ni, nj, tfac, temp1_ref, temp2_ref);
 		else
 			step_kernel_file(ni, nj, tfac, temp1_ref, temp2_ref);
@@ -127,105 +308,324 @@ int main(int argc, char *argv[])
 		temp1_ref = temp2_ref;
 		temp2_ref = temp;
 		
+		if(sample && !fused)
+			analytics_field_ref(ni, nj, temp1_ref, nprobe, probes, &hostRecs[nRecs]);
+		if(sample)
+			hostRecs[nRecs++].step = i + 1;
+		
+		if(saveSnap == 1) snap_write_frame(snap, temp1_ref);
+		if(saveSnap == 1 && i == 0) memcpy(snap_first, temp1_ref, sizeof(float) * size);
 	}
 	
     run_time  = wtime() - start_time;
+	cpu_time = run_time;
+	TRACE_END(start_time, "cpu run", "host");
 	
 	if(saveData == 1) printf("Numeric data saved to heat_con.csv\n");
+	if(saveSnap == 1) {
+		snap_close(snap);
+		printf("Compressed frames saved to heat_con.snap\n");
+		if (tSteps > 0) snap_verify("heat_con.snap", snap_first, temp1_ref);
+		free(snap_first);
+	}
 	
-	printf("Overall CPU preformance: %.3f miliseconds, transfer %.0f kB.\n",
-	run_time*1000, transfer);
+	if (hostRun)
+		printf("Overall CPU preformance: %.3f miliseconds, transfer %.0f kB.\n",
+		run_time*1000, transfer);
 	
 	run_time = 0;
 
 //--------------------------------------------------------------------------------
 // Run GPU version
 //--------------------------------------------------------------------------------
-    kernelsource = getKernelSource("C_heat_conduction.cl");
-    // Create the comput program from the source buffer
-    program = clCreateProgramWithSource(context, 1, (const char **) & kernelsource, NULL, &err);
-    checkError(err, "Creating program with C_heat_conduction.cl");
-    free(kernelsource);
-    // Build the program
-    err = clBuildProgram(program, 0, NULL, NULL, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        size_t len;
-        char buffer[2048];
+    TRACE_BEGIN(t_build);
 
-        printf("Error: Failed to build program executable!\n%s\n", err_code(err));
-        clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
-        printf("%s\n", buffer);
-        return EXIT_FAILURE;
+    if (specialize) {
+        // nine significant digits round-trip a float exactly
+        snprintf(options, sizeof(options), "-DSPEC_NI=%d -DSPEC_NJ=%d -DSPEC_FACT=%.8ef",
+            ni, nj, tfac);
+        kernelName = "step_kernel_spec";
+        bufArg = 0;
     }
 
+    // Build the program, or load it from the cache
+    kernelsource = getKernelSource("C_heat_conduction.cl");
+    program = build_program(context, device, kernelsource, options);
+    free(kernelsource);
+
     // Create the compute kernel from the program
-    kernel = clCreateKernel(program, "step_kernel_mod", &err);
+    kernel = clCreateKernel(program, kernelName, &err);
     if (!kernel || err != CL_SUCCESS)
     checkError(err, "Creating kernel with C_heat_conduction.cl");
 
+    ksum = clCreateKernel(program, "row_checksum", &err);
+    checkError(err, "Creating row checksum kernel");
+
+    TRACE_END(t_build, "build program", "host");
+
+    if (statsEvery > 0 && streamDev)
+        printf("Analytics are only recorded on the full-buffer device run, not with -oS\n");
+    else if (statsEvery > 0)
+        stats = analytics_dev_create(context, program, commands, ni, nj, tfac,
+            nprobe, probes, "heat_stats.csv", devRecs);
+
+    if (renderEvery > 0 && !streamDev)
+        renderer = render_dev_create(context, program, commands, ni, nj, renderScale);
+
     printf("\n===== Executing %d times device GPU version, order %d x %d ======\n",
 		tSteps, ni, nj);
 		
-    for (int i = 0; i < tSteps; i++)
-    {
-		   
+    // sizes and coefficient never change, only the buffers are swapped
+    if (!specialize) {
         err =  clSetKernelArg(kernel, 0, sizeof(int),    &ni);
         err |= clSetKernelArg(kernel, 1, sizeof(int),    &nj);
         err |= clSetKernelArg(kernel, 2, sizeof(float),  &tfac);
-        err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &temp1);
-        err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &temp2);
+        checkError(err, "Setting kernel args");
+    }
+
+    float *stream_res = temp_out;   // result of the streamed run
+
+    if (streamDev) {
+        struct stream_stats sst = {0}, part;
+        float *stream_in = temp_out, *stream_out = stream_other;
+
+        if (streamRows < 1) streamRows = stream_band_rows(device, ni, nj, streamSteps);
+
+        // with rendering the run stops at each frame, which is rendered from
+        // the streamed field in host memory outside the timed passes
+        TRACE_BEGIN(t_stream);
+        for (int done = 0; done < tSteps; ) {
+            int steps = gif && tSteps - done > renderEvery ? renderEvery : tSteps - done;
+
+            stream_run_device(context, device, program, ni, nj, tfac, steps,
+                streamRows, streamSteps, &stream_in, &stream_out, &part);
+            done += steps;
+
+            sst.runTime += part.runTime;
+            sst.bandRows = part.bandRows;
+            sst.passSteps = part.passSteps;
+            sst.passes += part.passes;
+            sst.bytesMoved += part.bytesMoved;
+
+            if (gif && done % renderEvery == 0) {
+                render_frame_ref(ni, nj, renderScale, stream_in, image);
+                gif_add_frame(gif, image);
+            }
+        }
+        TRACE_END(t_stream, "gpu streamed run", "host");
+        stream_res = stream_in;
+        run_time = sst.runTime * 1000;
+
+        printf("Streamed %d passes of %d steps through bands of %d rows, moved %.0f kB.\n",
+            sst.passes, sst.passSteps, sst.bandRows, sst.bytesMoved / 1024);
+    }
+
+    for (int i = 0; streamDev == 0 && i < tSteps; i++)
+    {
+        bool sample = stats && (i + 1) % statsEvery == 0;
+        bool fused = sample && !specialize;
+
+        err =  clSetKernelArg(kernel, bufArg,     sizeof(cl_mem), &temp1);
+        err |= clSetKernelArg(kernel, bufArg + 1, sizeof(cl_mem), &temp2);
 
         checkError(err, "Setting kernel args");
 
         start_time = wtime();
 
-        // Execute the kernel
-		const size_t global[2] = {ni-1, nj-1};
-        err = clEnqueueNDRangeKernel(
-            commands,
-            kernel,
-            2, NULL,
-            global, 0,
-            0, NULL, NULL);
-        checkError(err, "Enqueueing kernel");
+        if (fused) {
+            // the step also reduces the new field to a few bytes of statistics
+            analytics_dev_step(stats, temp1, temp2, i + 1, TRACE_EVENT(event));
+        }
+        else {
+            // Execute the kernel
+            const size_t global[2] = {ni-1, nj-1};
+            err = clEnqueueNDRangeKernel(
+                commands,
+                kernel,
+                2, NULL,
+                global, 0,
+                0, NULL, TRACE_EVENT(event));
+            checkError(err, "Enqueueing kernel");
+        }
+        if (sample && !fused)
+            analytics_dev_field(stats, temp2, i + 1);
 
         err = clFinish(commands);
         checkError(err, "Waiting for kernel to finish");
 
         run_time += (wtime() - start_time) * 1000;
+		TRACE_END(start_time, "gpu step", "host");
+		TRACE_CL(event, fused ? "step_kernel_stats" : kernelName, "kernel");
 		
 		// swap temperature pointers
 		temp_tmp = temp1;
 		temp1 = temp2;
 		temp2 = temp_tmp;	
 		
+		// only the 8-bit image comes back, the encoder thread does the rest
+		if (renderer && (i + 1) % renderEvery == 0) {
+			render_dev_frame(renderer, temp1, image);
+			gif_add_frame(gif, image);
+		}
+		
     } // end for loop
 	
-	err = clEnqueueReadBuffer(
+	TRACE_BEGIN(t_check);
+
+	if (streamDev) {
+		// the streamed result is already in host memory
+		if (!hostRun) mode_fill(ni, nj, tfac, tSteps, valStride, temp1_ref);
+		results(ni, nj, valStride, stream_res, temp1_ref);
+	}
+	else if (valChecksum) {
+		// reduce each row on the device and only read back nj sums
+		float *sums = (float *)calloc(nj, sizeof(float));
+		float *sums_ref = (float *)calloc(nj, sizeof(float));
+		cl_mem d_sums = clCreateBuffer(context, CL_MEM_WRITE_ONLY,
+                            sizeof(float) * nj, NULL, &err);
+		checkError(err, "Creating buffer sums");
+
+		err =  clSetKernelArg(ksum, 0, sizeof(int),    &ni);
+		err |= clSetKernelArg(ksum, 1, sizeof(int),    &nj);
+		err |= clSetKernelArg(ksum, 2, sizeof(cl_mem), &temp1);
+		err |= clSetKernelArg(ksum, 3, sizeof(cl_mem), &d_sums);
+		checkError(err, "Setting checksum kernel args");
+
+		const size_t rows = nj;
+		err = clEnqueueNDRangeKernel(commands, ksum, 1, NULL, &rows, NULL, 0, NULL, TRACE_EVENT(event));
+		checkError(err, "Enqueueing checksum kernel");
+		TRACE_CL(event, "row_checksum", "kernel");
+
+		err = clEnqueueReadBuffer(commands, d_sums, CL_TRUE, 0,
+            sizeof(float) * nj, sums, 0, NULL, TRACE_EVENT(event));
+		checkError(err, "Reading back sums");
+		TRACE_CL(event, "read sums", "transfer");
+
+		if (hostRun)
+			row_checksum_ref(ni, nj, temp1_ref, sums_ref);
+		else
+			mode_row_sums(ni, nj, tfac, tSteps, sums_ref);
+		results_checksum(ni, nj, sums, sums_ref);
+
+		clReleaseMemObject(d_sums);
+		free(sums);
+		free(sums_ref);
+	}
+	else if (valStride > 1) {
+		// read only the sampled rows, in place, with one strided copy;
+		// origin y counts in pitches, so start at row 1 through the x offset
+		const size_t origin[3] = {sizeof(float) * ni, 0, 0};
+		const size_t region[3] = {sizeof(float) * ni, (nj - 2 + valStride - 1) / valStride, 1};
+		const size_t pitch = sizeof(float) * ni * valStride;
+
+		err = clEnqueueReadBufferRect(
+            commands, temp1, CL_TRUE, origin, origin, region,
+            pitch, 0, pitch, 0, temp_out,
+            0, NULL, TRACE_EVENT(event));
+        checkError(err, "Reading back sampled rows");
+		TRACE_CL(event, "read sampled rows", "transfer");
+
+		// the reference is only needed at the sampled cells
+		if (!hostRun) mode_fill(ni, nj, tfac, tSteps, valStride, temp1_ref);
+		results(ni, nj, valStride, temp_out, temp1_ref);
+	}
+	else {
+		err = clEnqueueReadBuffer(
             commands, temp1, CL_TRUE, 0,
             sizeof(float) * size, temp_out,
-            0, NULL, NULL);
+            0, NULL, TRACE_EVENT(event));
         checkError(err, "Reading back temp2");
+		TRACE_CL(event, "read field", "transfer");
+
+		results(ni, nj, 1, temp_out, temp1_ref);
+	}
 	
-	results(ni, nj, temp_out, temp1_ref);
+	TRACE_END(t_check, "readback and validate", "host");
+
+	if (renderer) {
+		// render the final fields on both sides, they differ only by rounding
+		long differ = 0;
+		render_dev_frame(renderer, temp1, image);
+		render_frame_ref(ni, nj, renderScale, temp1_ref, image_ref);
+		for (long p = 0; p < (long)imageW * imageH; p++)
+			differ += image[p] != image_ref[p];
+		printf("Rendering: %ld of %d pixels of the final frame differ from the host rendering.\n",
+			differ, imageW * imageH);
+		render_dev_release(renderer);
+	}
+
+	if (stats) {
+		int n = analytics_dev_close(stats);
+		analytics_compare(n < nRecs ? n : nRecs, devRecs, hostRecs, nprobe);
+		printf("Analytics every %d steps saved to heat_stats.csv\n", statsEvery);
+	}
+
 	printf("Overall GPU performance: %.3f miliseconds, transfer %.0f kB. \n\n",
 	run_time, transfer);
 
+//--------------------------------------------------------------------------------
+// Run co-executed version
+//--------------------------------------------------------------------------------
+	if (coExec) {
+		struct coexec_stats co;
+		double cells = (double)(ni - 2) * (nj - 2) * tSteps;
+
+		printf("===== Executing %d times co-executed CPU + device version, order %d x %d ======\n",
+			tSteps, ni, nj);
+
+		// start from the split the two separate runs suggest
+		float cpuShare = run_time / (run_time + cpu_time * 1000);
+
+		TRACE_BEGIN(t_co);
+		float *co_res = coexec_run(context, device, program, ni, nj, tfac, tSteps,
+			cpuShare, co_in, co_out, &co);
+		TRACE_END(t_co, "co-exec run", "host");
+
+		results(ni, nj, 1, co_res, temp1_ref);
+		printf("Overall co-executed performance: %.3f miliseconds, %d of %d rows on the CPU at the end.\n",
+			co.runTime * 1000, co.cpuRows, nj - 2);
+		printf("Busy time: CPU %.3f miliseconds, device %.3f miliseconds (%.3f of it halo transfers).\n",
+			co.cpuTime * 1000, co.devTime * 1000, co.xferTime * 1000);
+		printf("Throughput: co-executed %.2f, CPU alone %.2f, device alone %.2f Mcells/s.\n\n",
+			cells / co.runTime * 1e-6, cells / cpu_time * 1e-6, cells / run_time * 1e-3);
+	}
+
 //--------------------------------------------------------------------------------
 // Clean up
 //--------------------------------------------------------------------------------
-	free(temp1_ref);
-    free(temp2_ref);
-	free(temp_out);
+	if (gif) {
+		int frames = gif_close(gif);
+		printf("%d frames of %d x %d pixels saved to heat_con.gif\n", frames, imageW, imageH);
+	}
+	free(image);
+	free(image_ref);
+
+	if (fields) {
+		stream_unmap(fields, ni, nj, fieldCount);
+	}
+	else {
+		grid_free(temp1_ref);
+		grid_free(temp2_ref);
+		grid_free(temp_out);
+		grid_free(stream_other);
+	}
+	grid_free(co_in);
+	grid_free(co_out);
+	free(hostRecs);
+	free(devRecs);
 	
-	clReleaseMemObject(temp1);
-    clReleaseMemObject(temp2);
+	if (!streamDev) {
+		clReleaseMemObject(temp1);
+		clReleaseMemObject(temp2);
+	}
     clReleaseProgram(program);
     clReleaseKernel(kernel);
+    clReleaseKernel(ksum);
     clReleaseCommandQueue(commands);
     clReleaseContext(context);
 
+    trace_close();
+
     return EXIT_SUCCESS;
 }
 
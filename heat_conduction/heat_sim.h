@@ -18,6 +18,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
 
 #ifdef __APPLE__
 #include <OpenCL/opencl.h>
@@ -27,12 +28,23 @@
 #endif
 
 #include "matrix_lib.h"
+#include "trace.h"
+#include "program_cache.h"
+#include "snapshot.h"
+#include "coexec.h"
+#include "grid_alloc.h"
+#include "stream.h"
+#include "analytics.h"
+#include "render.h"
 
 //------------------------------------------------------------------------------
 //  functions from ../C_Common
 //------------------------------------------------------------------------------
 extern int    output_device_info(cl_device_id );
 extern double wtime();   // returns time since some fixed past point (wtime.c)
+extern const char *err_code(cl_int);   // defined in err_code.h, include it once
+extern void check_error(cl_int, const char *, char *, int);
+#define checkError(E, S) check_error(E,S,__FILE__,__LINE__)
 
 //------------------------------------------------------------------------------
 //  Constants
@@ -44,6 +56,7 @@ extern double wtime();   // returns time since some fixed past point (wtime.c)
 #define COUNT    30       // number of times to do each multiplication
 #define SUCCESS  1
 #define FAILURE  0
-#define I2D(num, c, r) ((r)*(num)+(c)) // Indexing into a 1D array from 2D space
+#define I2D(num, c, r) ((size_t)(r)*(num)+(c)) // Indexing into a 1D array from 2D space,
+                                              // in size_t so fields may pass 2^31 cells
 
 #endif
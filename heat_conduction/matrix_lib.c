@@ -16,8 +16,42 @@
 //
 //------------------------------------------------------------------------------
 
+#include <stdint.h>
+#include <assert.h>
 #include "heat_sim.h"
 
+#define MODE_AMP 100.0   // peak of the initmat_mode field, as high as initmat goes
+#define MODE_PI  3.14159265358979323846
+
+// isnan and isinf are folded away under -ffast-math, so test the exponent bits
+static inline int not_finite(float x)
+{
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	return (bits & 0x7f800000u) == 0x7f800000u;
+}
+
+// half-waves of the initmat_mode field across n cells, a quarter of the most
+// the grid holds, so each step changes it by far more than float rounding
+static int mode_waves(int n)
+{
+	return (n - 1) / 4 > 1 ? (n - 1) / 4 : 1;
+}
+
+// shape of the initmat_mode field along one axis, zero at both boundaries
+static double mode_shape(int n, int i)
+{
+	return sin(MODE_PI * mode_waves(n) * i / (n - 1));
+}
+
+// decay of the initmat_mode field per step, the eigenvalue of the stencil
+static double mode_decay(int ni, int nj, float fact)
+{
+	double sx = sin(MODE_PI * mode_waves(ni) / (2.0 * (ni - 1)));
+	double sy = sin(MODE_PI * mode_waves(nj) / (2.0 * (nj - 1)));
+	return 1.0 - 4.0 * fact * (sx * sx + sy * sy);
+}
+
 //------------------------------------------------------------------------------
 //
 //	Referential function for calculating heat transfer to be run on the CPU
@@ -25,27 +59,101 @@
 //------------------------------------------------------------------------------
 void step_kernel_ref(int ni, int nj, float fact, float* temp_in, float* temp_out)
 {
-  int i00, im10, ip10, i0m1, i0p1;
-  float d2tdx2, d2tdy2;		
-		
   // loop over all points in domain (except boundary)
-  for ( int j=1; j < nj-1; j++ ) {
-    for ( int i=1; i < ni-1; i++ ) {
-      // find indices into linear memory
-      // for central point and neighbours
-      i00 = I2D(ni, i, j);
-      im10 = I2D(ni, i-1, j);
-      ip10 = I2D(ni, i+1, j);
-      i0m1 = I2D(ni, i, j-1);
-      i0p1 = I2D(ni, i, j+1);
+  step_kernel_band(ni, nj, 1, nj-1, fact, temp_in, temp_out);
+}
 
-      // evaluate derivatives
-      d2tdx2 = temp_in[im10]-2*temp_in[i00]+temp_in[ip10];
-      d2tdy2 = temp_in[i0m1]-2*temp_in[i00]+temp_in[i0p1];
+//------------------------------------------------------------------------------
+//
+//	Referential function for rows j0 to j1-1 only, 1 <= j0 and j1 <= nj-1
+//
+//------------------------------------------------------------------------------
+void step_kernel_band(int ni, int nj, int j0, int j1, float fact, float* temp_in, float* temp_out)
+{
+  assert(1 <= j0 && j1 <= nj-1);
 
-      // update temperatures
-      temp_out[i00] = temp_in[i00]+fact*(d2tdx2 + d2tdy2);
+  // rows are split statically over the threads, each thread records its span
+  #pragma omp parallel
+  {
+    size_t i00, im10, ip10, i0m1, i0p1;
+    float d2tdx2, d2tdy2;
+    TRACE_BEGIN(t0);
+
+    #pragma omp for schedule(static) nowait
+    for ( int j=j0; j < j1; j++ ) {
+      for ( int i=1; i < ni-1; i++ ) {
+        // find indices into linear memory
+        // for central point and neighbours
+        i00 = I2D(ni, i, j);
+        im10 = I2D(ni, i-1, j);
+        ip10 = I2D(ni, i+1, j);
+        i0m1 = I2D(ni, i, j-1);
+        i0p1 = I2D(ni, i, j+1);
+
+        // evaluate derivatives
+        d2tdx2 = temp_in[im10]-2*temp_in[i00]+temp_in[ip10];
+        d2tdy2 = temp_in[i0m1]-2*temp_in[i00]+temp_in[i0p1];
+
+        // update temperatures
+        temp_out[i00] = temp_in[i00]+fact*(d2tdx2 + d2tdy2);
+      }
     }
+
+    TRACE_END(t0, "cpu step", "cpu");
+  }
+}
+
+//------------------------------------------------------------------------------
+//
+//	Referential function specialised for a width W known at compile time,
+//	so the row stride is a constant and the inner loop has a fixed trip count
+//
+//------------------------------------------------------------------------------
+#define STEP_KERNEL_REF_WIDTH(W)                                                \
+static void step_kernel_ref_##W(int nj, float fact,                             \
+                                const float* restrict temp_in,                  \
+                                float* restrict temp_out)                       \
+{                                                                               \
+  _Pragma("omp parallel")                                                       \
+  {                                                                             \
+    TRACE_BEGIN(t0);                                                            \
+    _Pragma("omp for schedule(static) nowait")                                  \
+    for ( int j=1; j < nj-1; j++ ) {                                            \
+      const float* restrict in = temp_in + I2D(W, 0, j);                        \
+      float* restrict out = temp_out + I2D(W, 0, j);                            \
+      for ( int i=1; i < W-1; i++ ) {                                           \
+        float d2tdx2 = in[i-1]-2*in[i]+in[i+1];                                 \
+        float d2tdy2 = in[i-W]-2*in[i]+in[i+W];                                 \
+        out[i] = in[i]+fact*(d2tdx2 + d2tdy2);                                  \
+      }                                                                         \
+    }                                                                           \
+    TRACE_END(t0, "cpu step", "cpu");                                           \
+  }                                                                             \
+}
+
+STEP_KERNEL_REF_WIDTH(256)
+STEP_KERNEL_REF_WIDTH(320)
+STEP_KERNEL_REF_WIDTH(512)
+STEP_KERNEL_REF_WIDTH(1024)
+STEP_KERNEL_REF_WIDTH(2048)
+STEP_KERNEL_REF_WIDTH(4096)
+
+//------------------------------------------------------------------------------
+//
+//	Referential function specialised for common widths, falls back to
+//	step_kernel_ref for any other width
+//
+//------------------------------------------------------------------------------
+void step_kernel_ref_spec(int ni, int nj, float fact, float* temp_in, float* temp_out)
+{
+  switch (ni) {
+    case 256:  step_kernel_ref_256(nj, fact, temp_in, temp_out);  break;
+    case 320:  step_kernel_ref_320(nj, fact, temp_in, temp_out);  break;
+    case 512:  step_kernel_ref_512(nj, fact, temp_in, temp_out);  break;
+    case 1024: step_kernel_ref_1024(nj, fact, temp_in, temp_out); break;
+    case 2048: step_kernel_ref_2048(nj, fact, temp_in, temp_out); break;
+    case 4096: step_kernel_ref_4096(nj, fact, temp_in, temp_out); break;
+    default:   step_kernel_ref(ni, nj, fact, temp_in, temp_out);  break;
   }
 }
 
@@ -56,7 +164,7 @@ void step_kernel_ref(int ni, int nj, float fact, float* temp_in, float* temp_out
 //------------------------------------------------------------------------------
 void step_kernel_file(int ni, int nj, float fact, float* temp_in, float* temp_out)
 {
-  int i00, im10, ip10, i0m1, i0p1;
+  size_t i00, im10, ip10, i0m1, i0p1;
   float d2tdx2, d2tdy2;
   
   FILE *f = fopen("heat_con.csv", "a");
@@ -91,35 +199,222 @@ void step_kernel_file(int ni, int nj, float fact, float* temp_in, float* temp_ou
 //  Function to initialize matrices with random data
 //
 //------------------------------------------------------------------------------
-void initmat(int size, float *temp1, float *temp2, float *temp3)
+void initmat(size_t size, float *temp1, float *temp2, float *temp3)
 {
-	for( int i = 0; i < size; ++i) {
+	for( size_t i = 0; i < size; ++i) {
 		temp1[i] = temp2[i] = (float)rand()/(float)(RAND_MAX/100.0f);
 		temp3[i] = 0;
   }
 }
 
+//------------------------------------------------------------------------------
+//
+//  Function to initialize matrices with a mode of the stencil, a product of
+//  sines that is zero on the boundary and that every step only scales
+//
+//------------------------------------------------------------------------------
+void initmat_mode(int ni, int nj, float *temp1, float *temp2, float *temp3)
+{
+	#pragma omp parallel for schedule(static)
+	for ( int j = 0; j < nj; j++ ) {
+		double sy = MODE_AMP * mode_shape(nj, j);
+		for ( int i = 0; i < ni; i++ ) {
+			bool edge = i == 0 || j == 0 || i == ni-1 || j == nj-1;
+			size_t k = I2D(ni, i, j);
+			temp1[k] = temp2[k] = edge ? 0 : (float)(sy * mode_shape(ni, i));
+			temp3[k] = 0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to write the closed-form field steps steps after initmat_mode
+//  into the interior cells of every stride-th row and column of temp
+//
+//------------------------------------------------------------------------------
+void mode_fill(int ni, int nj, float fact, int steps, int stride, float *temp)
+{
+	double amp = MODE_AMP * pow(mode_decay(ni, nj, fact), steps);
+
+	#pragma omp parallel for schedule(static)
+	for ( int j = 1; j < nj-1; j += stride ) {
+		double sy = amp * mode_shape(nj, j);
+		for ( int i = 1; i < ni-1; i += stride )
+			temp[I2D(ni, i, j)] = (float)(sy * mode_shape(ni, i));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the closed-form row sums steps steps after initmat_mode,
+//  as row_checksum_ref would compute them
+//
+//------------------------------------------------------------------------------
+void mode_row_sums(int ni, int nj, float fact, int steps, float *sums)
+{
+	double amp = MODE_AMP * pow(mode_decay(ni, nj, fact), steps);
+	double rowSum = 0;
+
+	for ( int i = 1; i < ni-1; i++ )
+		rowSum += mode_shape(ni, i);
+	for ( int j = 1; j < nj-1; j++ )
+		sums[j] = (float)(amp * rowSum * mode_shape(nj, j));
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compare interior cells of two fields, every stride-th row and
+//  column (stride 1 compares all of them)
+//
+//------------------------------------------------------------------------------
+void compare_fields(int ni, int nj, int stride, const float *temp,
+                    const float *temp_ref, struct val_stats *st)
+{
+	double sumErr2 = 0, sumRef2 = 0;
+	long overTol = 0, checked = 0, nonFinite = 0;
+	float maxError = -1;
+	int maxI = 0, maxJ = 0;
+
+	#pragma omp parallel
+	{
+		// worst cell seen by this thread
+		float myMax = -1;
+		int myI = 0, myJ = 0;
+
+		#pragma omp for schedule(static) reduction(+:sumErr2, sumRef2, overTol, checked, nonFinite)
+		for ( int j = 1; j < nj-1; j += stride ) {
+			const float *row = temp + I2D(ni, 0, j);
+			const float *rowRef = temp_ref + I2D(ni, 0, j);
+			float rowMax = 0;
+			double err2 = 0, ref2 = 0;
+			int over = 0, bad = 0;
+
+			// NaN and infinite cells fail on their own, fmaxf and > would pass NaN
+			#pragma omp simd reduction(max:rowMax) reduction(+:err2, ref2, over, bad)
+			for ( int i = 1; i < ni-1; i += stride ) {
+				int nf = not_finite(row[i]);
+				float d = nf ? 0 : fabsf(row[i] - rowRef[i]);
+				rowMax = fmaxf(rowMax, d);
+				err2 += (double)d * d;
+				ref2 += (double)rowRef[i] * rowRef[i];
+				over += nf || d > TOL;
+				bad += nf;
+			}
+
+			sumErr2 += err2;
+			sumRef2 += ref2;
+			overTol += over;
+			nonFinite += bad;
+			checked += (ni - 2 + stride - 1) / stride;
+
+			// only rescan rows that beat the current worst cell
+			if (rowMax > myMax) {
+				for ( int i = 1; i < ni-1; i += stride ) {
+					if (!not_finite(row[i]) && fabsf(row[i] - rowRef[i]) == rowMax) {
+						myMax = rowMax;
+						myI = i;
+						myJ = j;
+						break;
+					}
+				}
+			}
+		}
+
+		#pragma omp critical
+		{
+			if (myMax > maxError || (myMax == maxError && I2D(ni, myI, myJ) < I2D(ni, maxI, maxJ))) {
+				maxError = myMax;
+				maxI = myI;
+				maxJ = myJ;
+			}
+		}
+	}
+
+	st->maxError = maxError < 0 ? 0 : maxError;
+	st->maxI = maxI;
+	st->maxJ = maxJ;
+	st->rms = checked ? sqrt(sumErr2 / checked) : 0;
+	st->relL2 = sumRef2 > 0 ? sqrt(sumErr2 / sumRef2) : sqrt(sumErr2);
+	st->overTol = overTol;
+	st->nonFinite = nonFinite;
+	st->checked = checked;
+}
+
 //------------------------------------------------------------------------------
 //
 //  Function to analyze and output results
 //
 //------------------------------------------------------------------------------
-void results(int ni, int nj, float *temp, float *temp_ref)
+void results(int ni, int nj, int stride, float *temp, float *temp_ref)
 {
+	struct val_stats st;
+
+	compare_fields(ni, nj, stride, temp, temp_ref, &st);
 
+	if (stride > 1)
+		printf("Validated a sample of every %d-th row and column.\n", stride);
+	printf("RMS error %.3e, relative L2 error %.3e, %ld of %ld cells over tolerance.\n",
+		st.rms, st.relL2, st.overTol, st.checked);
+
+	// Check and see if our maxError is greater than an error bound
+	if (st.nonFinite > 0)
+		printf("Problem! %ld cells are NaN or infinite.\n", st.nonFinite);
+	else if (st.maxError > TOL)
+		printf("Problem! The Max Error of %.5f (in temp(%d, %d)) is NOT within acceptable bounds.\n",
+			st.maxError, st.maxI, st.maxJ);
+	else
+		printf("The Max Error of %.5f (in temp(%d, %d)) is within acceptable bounds.\n",
+			st.maxError, st.maxI, st.maxJ);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to sum the interior cells of each row, matches row_checksum kernel
+//
+//------------------------------------------------------------------------------
+void row_checksum_ref(int ni, int nj, const float *temp, float *sums)
+{
+	#pragma omp parallel for schedule(static)
+	for ( int j = 1; j < nj-1; j++ ) {
+		float sum = 0;
+		for ( int i = 1; i < ni-1; i++ )
+			sum += temp[I2D(ni, i, j)];
+		sums[j] = sum;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to analyze and output results from per-row checksums
+//
+//------------------------------------------------------------------------------
+void results_checksum(int ni, int nj, float *sums, float *sums_ref)
+{
 	float maxError = 0;
-	int id = 0;
+	float bound = TOL * (ni - 2);   // every cell of the row at the tolerance
+	int id = 1, nonFinite = 0, badRow = 0;
 
-	for( int i = 0; i < ni*nj; ++i ) {
-		if (fabs(temp[i]-temp_ref[i]) > maxError) { 
-			maxError = fabs(temp[i]-temp_ref[i]); 
-			id = i;
+	// raw deviation of each row sum, a single bad cell is not averaged away
+	for ( int j = 1; j < nj-1; j++ ) {
+		if (not_finite(sums[j])) {
+			if (nonFinite++ == 0)
+				badRow = j;
+			continue;
+		}
+		float d = fabsf(sums[j] - sums_ref[j]);
+		if (d > maxError) {
+			maxError = d;
+			id = j;
 		}
 	}
 
-	// Check and see if our maxError is greater than an error bound
-	if (maxError > TOL)
-		printf("Problem! The Max Error of %.5f (in temp[%d]) is NOT within acceptable bounds.\n", maxError, id);
+	if (nonFinite > 0)
+		printf("Problem! %d row sums are NaN or infinite (first in row %d).\n", nonFinite, badRow);
+	else if (maxError > bound)
+		printf("Problem! The Max row sum error of %.5f (in row %d) is NOT within the row bound of %.5f.\n",
+			maxError, id, bound);
 	else
-		printf("The Max Error of %.5f is within acceptable bounds.\n", maxError);
-}
\ No newline at end of file
+		printf("The Max row sum error of %.5f (in row %d) is within the row bound of %.5f.\n",
+			maxError, id, bound);
+}
@@ -13,6 +13,21 @@
 #ifndef __MATRIX_LIB_HDR
 #define __MATRIX_LIB_HDR
 
+//------------------------------------------------------------------------------
+//
+//	Error statistics gathered when validating a field against the reference
+//
+//------------------------------------------------------------------------------
+struct val_stats {
+	float  maxError;   // largest absolute error
+	int    maxI, maxJ; // location of the largest error
+	double rms;        // root mean square error
+	double relL2;      // L2 norm of the error relative to L2 norm of reference
+	long   overTol;    // number of cells with error above TOL, or not finite
+	long   nonFinite;  // number of NaN or infinite cells
+	long   checked;    // number of cells compared
+};
+
 //------------------------------------------------------------------------------
 //
 //	Referential function for calculating heat transfer to be run on the CPU
@@ -20,6 +35,21 @@
 //------------------------------------------------------------------------------
 void step_kernel_ref(int ni, int nj, float fact, float* temp_in, float* temp_out);
 
+//------------------------------------------------------------------------------
+//
+//	Referential function for rows j0 to j1-1 only, 1 <= j0 and j1 <= nj-1
+//
+//------------------------------------------------------------------------------
+void step_kernel_band(int ni, int nj, int j0, int j1, float fact, float* temp_in, float* temp_out);
+
+//------------------------------------------------------------------------------
+//
+//	Referential function specialised for common widths, falls back to
+//	step_kernel_ref for any other width
+//
+//------------------------------------------------------------------------------
+void step_kernel_ref_spec(int ni, int nj, float fact, float* temp_in, float* temp_out);
+
 //------------------------------------------------------------------------------
 //
 //	Referential function which includes saving data to file
@@ -32,13 +62,60 @@ void step_kernel_file(int ni, int nj, float fact, float* temp_in, float* temp_ou
 //  Function to initialize matrices with random data
 //
 //------------------------------------------------------------------------------
-void initmat(int size, float *temp1, float *temp2, float *temp3);
+void initmat(size_t size, float *temp1, float *temp2, float *temp3);
+
+//------------------------------------------------------------------------------
+//
+//  Function to initialize matrices with a mode of the stencil, a product of
+//  sines that is zero on the boundary and that every step only scales
+//
+//------------------------------------------------------------------------------
+void initmat_mode(int ni, int nj, float *temp1, float *temp2, float *temp3);
+
+//------------------------------------------------------------------------------
+//
+//  Function to write the closed-form field steps steps after initmat_mode
+//  into the interior cells of every stride-th row and column of temp
+//
+//------------------------------------------------------------------------------
+void mode_fill(int ni, int nj, float fact, int steps, int stride, float *temp);
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the closed-form row sums steps steps after initmat_mode,
+//  as row_checksum_ref would compute them
+//
+//------------------------------------------------------------------------------
+void mode_row_sums(int ni, int nj, float fact, int steps, float *sums);
+
+//------------------------------------------------------------------------------
+//
+//  Function to compare interior cells of two fields, every stride-th row and
+//  column (stride 1 compares all of them)
+//
+//------------------------------------------------------------------------------
+void compare_fields(int ni, int nj, int stride, const float *temp,
+                    const float *temp_ref, struct val_stats *st);
 
 //------------------------------------------------------------------------------
 //
 //  Function to analyze and output results 
 //
 //------------------------------------------------------------------------------
-void results(int ni, int nj, float *temp, float *temp_ref);
+void results(int ni, int nj, int stride, float *temp, float *temp_ref);
+
+//------------------------------------------------------------------------------
+//
+//  Function to sum the interior cells of each row, matches row_checksum kernel
+//
+//------------------------------------------------------------------------------
+void row_checksum_ref(int ni, int nj, const float *temp, float *sums);
+
+//------------------------------------------------------------------------------
+//
+//  Function to analyze and output results from per-row checksums
+//
+//------------------------------------------------------------------------------
+void results_checksum(int ni, int nj, float *sums, float *sums_ref);
     
 #endif
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Host stencil throughput against the number of NUMA nodes used
+//
+//  USAGE:   ./numa_bench [-mW= MatWidth] [-mH= MatHeight] [-tS= TimeSteps]
+//                        [-hT | -hE]
+//           For 1 to all nodes, pins one thread to every CPU of the nodes in
+//           use, first touches the grids from those threads and reports
+//           cell updates per second. On a machine without NUMA it runs once
+//           on all threads without pinning.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include "heat_sim.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define BENCH_MAX_CPUS 1024
+
+int main(int argc, char *argv[])
+{
+	int ni = 4096, nj = 4096, tSteps = 20;
+	float tfac = 8.418e-5;
+	struct grid_opts opts = {GRID_FIRST_TOUCH, 0, GRID_PAGES_DEFAULT};
+	static int cpus[BENCH_MAX_CPUS];
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-mW=") == 0 && i + 1 < argc) ni = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-mH=") == 0 && i + 1 < argc) nj = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-tS=") == 0 && i + 1 < argc) tSteps = atoi(argv[i+1]);
+		if (strcmp(argv[i], "-hT") == 0) opts.pages = GRID_PAGES_THP;
+		if (strcmp(argv[i], "-hE") == 0) opts.pages = GRID_PAGES_HUGETLB;
+	}
+
+	int nodes = grid_numa_nodes();
+	bool numa = nodes > 1;
+	double cells = (double)(ni - 2) * (nj - 2) * tSteps;
+
+	printf("\n===== Host stencil, order %d x %d, %d steps, %d NUMA node(s) ======\n",
+		ni, nj, tSteps, nodes);
+	if (!numa)
+		printf("NUMA not available, running once without pinning\n");
+	printf("%6s %8s %12s %12s %18s\n", "Nodes", "Threads", "Time ms", "Mcells/s", "Mcells/s per node");
+
+	for (int used = 1; used <= nodes; used++) {
+		int ncpus = 0;
+
+		if (numa) {
+			for (int node = 0; node < used; node++)
+				ncpus += grid_node_cpus(node, cpus + ncpus, BENCH_MAX_CPUS - ncpus);
+			if (ncpus == 0)
+				continue;
+#ifdef _OPENMP
+			omp_set_num_threads(ncpus);
+#endif
+			// the pinning sticks to the pool threads for the runs below
+			#pragma omp parallel
+			{
+				int t = 0;
+#ifdef _OPENMP
+				t = omp_get_thread_num();
+#endif
+				grid_pin_thread(cpus[t % ncpus]);
+			}
+		}
+		else {
+			ncpus = 1;
+#ifdef _OPENMP
+			ncpus = omp_get_max_threads();
+#endif
+		}
+
+		float *temp1 = grid_alloc(ni, nj, &opts);
+		float *temp2 = grid_alloc(ni, nj, &opts);
+		float *tmp;
+
+		for (size_t k = 0; k < (size_t)ni * nj; k++)
+			temp1[k] = (float)(k % 100);
+
+		// one untimed step to fault in anything the first touch missed
+		step_kernel_band(ni, nj, 1, nj-1, tfac, temp1, temp2);
+
+		double start = wtime();
+		for (int t = 0; t < tSteps; t++) {
+			step_kernel_band(ni, nj, 1, nj-1, tfac, temp1, temp2);
+			tmp = temp1;
+			temp1 = temp2;
+			temp2 = tmp;
+		}
+		double run_time = wtime() - start;
+
+		printf("%6d %8d %12.3f %12.1f %18.1f\n", numa ? used : 1, ncpus, run_time * 1000,
+			cells / run_time * 1e-6, cells / run_time * 1e-6 / (numa ? used : 1));
+
+		grid_free(temp1);
+		grid_free(temp2);
+
+		if (!numa)
+			break;
+	}
+	printf("\n");
+
+	return EXIT_SUCCESS;
+}
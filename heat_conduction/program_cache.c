@@ -0,0 +1,146 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: On-disk cache of built OpenCL programs
+//
+//  PURPOSE: Binaries are stored as PROGRAM_CACHE_DIR/<key>.bin, where the key
+//           hashes everything that affects the build. A missing, stale or
+//           rejected binary silently falls back to building from source.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/stat.h>
+#include "heat_sim.h"
+
+// 64-bit FNV-1a, continued from hash
+static unsigned long long hash_str(unsigned long long hash, const char *str)
+{
+	for ( ; *str; str++) {
+		hash ^= (unsigned char)*str;
+		hash *= 1099511628211ULL;
+	}
+	// separator, so that "ab"+"c" and "a"+"bc" differ
+	hash ^= 0xff;
+	hash *= 1099511628211ULL;
+	return hash;
+}
+
+static unsigned long long cache_key(cl_device_id device, const char *source, const char *options)
+{
+	char info[1024];
+	unsigned long long hash = 14695981039346656037ULL;
+	const cl_device_info fields[3] = { CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION };
+
+	for (int k = 0; k < 3; k++) {
+		info[0] = '\0';
+		clGetDeviceInfo(device, fields[k], sizeof(info), info, NULL);
+		info[sizeof(info) - 1] = '\0';
+		hash = hash_str(hash, info);
+	}
+	hash = hash_str(hash, options ? options : "");
+	return hash_str(hash, source);
+}
+
+static cl_program load_binary(cl_context context, cl_device_id device,
+                              const char *path, const char *options)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	size_t len = ftell(file);
+	rewind(file);
+
+	unsigned char *binary = (unsigned char *)malloc(len);
+	if (!binary || fread(binary, 1, len, file) != len) {
+		free(binary);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+
+	cl_int err, status;
+	cl_program program = clCreateProgramWithBinary(context, 1, &device, &len,
+		(const unsigned char **)&binary, &status, &err);
+	free(binary);
+	if (err != CL_SUCCESS || status != CL_SUCCESS)
+		return NULL;
+
+	if (clBuildProgram(program, 1, &device, options, NULL, NULL) != CL_SUCCESS) {
+		clReleaseProgram(program);
+		return NULL;
+	}
+	return program;
+}
+
+static void store_binary(cl_program program, const char *path)
+{
+	size_t len = 0;
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &len, NULL) != CL_SUCCESS || len == 0)
+		return;
+
+	unsigned char *binary = (unsigned char *)malloc(len);
+	if (!binary)
+		return;
+
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char *), &binary, NULL) == CL_SUCCESS) {
+		mkdir(PROGRAM_CACHE_DIR, 0755);
+
+		// write under a temporary name so a concurrent run never sees half a file
+		char tmp[272];
+		snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+		FILE *file = fopen(tmp, "wb");
+		if (file) {
+			bool ok = fwrite(binary, 1, len, file) == len;
+			ok = fclose(file) == 0 && ok;
+			if (!ok || rename(tmp, path) != 0)
+				remove(tmp);
+		}
+	}
+	free(binary);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to build a program for one device, reusing the binary from an
+//  earlier build with the same source, options, device and driver if there
+//  is one in PROGRAM_CACHE_DIR. Prints the build log and exits on failure.
+//
+//------------------------------------------------------------------------------
+cl_program build_program(cl_context context, cl_device_id device,
+                         const char *source, const char *options)
+{
+	char path[256];
+	cl_int err;
+
+	snprintf(path, sizeof(path), "%s/%016llx.bin", PROGRAM_CACHE_DIR,
+		cache_key(device, source, options));
+
+	cl_program program = load_binary(context, device, path, options);
+	if (program)
+		return program;
+
+	// Create the compute program from the source buffer
+	program = clCreateProgramWithSource(context, 1, &source, NULL, &err);
+	checkError(err, "Creating program from source");
+
+	// Build the program
+	err = clBuildProgram(program, 1, &device, options, NULL, NULL);
+	if (err != CL_SUCCESS)
+	{
+		size_t len;
+		char buffer[2048];
+
+		printf("Error: Failed to build program executable!\n%s\n", err_code(err));
+		clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
+		printf("%s\n", buffer);
+		exit(EXIT_FAILURE);
+	}
+
+	store_binary(program, path);
+	return program;
+}
@@ -0,0 +1,24 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Program cache include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __PROGRAM_CACHE_HDR
+#define __PROGRAM_CACHE_HDR
+
+#define PROGRAM_CACHE_DIR ".clcache"   // directory holding cached binaries
+
+//------------------------------------------------------------------------------
+//
+//  Function to build a program for one device, reusing the binary from an
+//  earlier build with the same source, options, device and driver if there
+//  is one in PROGRAM_CACHE_DIR. Prints the build log and exits on failure.
+//
+//------------------------------------------------------------------------------
+cl_program build_program(cl_context context, cl_device_id device,
+                         const char *source, const char *options);
+
+#endif
@@ -0,0 +1,430 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: In-situ rendering
+//
+//  PURPOSE: Fields are averaged over scale x scale blocks of interior cells
+//           and mapped onto a 256 entry palette where they live, so only an
+//           8-bit image leaves the device per frame. Frames are queued to a
+//           background thread that LZW-encodes them into an animated GIF
+//           while the simulation carries on. The palette is the black to
+//           red ramp of heat_conduction_visualisation.m, which this replaces.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <pthread.h>
+#include "heat_sim.h"
+
+#define LZW_MIN_BITS 8                      // bits per pixel index
+#define LZW_CLEAR    (1 << LZW_MIN_BITS)
+#define LZW_EOI      (LZW_CLEAR + 1)
+#define LZW_MAX_CODE 4095                   // codes are at most 12 bits
+
+struct render_dev {
+	cl_command_queue queue;
+	cl_kernel kernel;
+	cl_mem image;
+	size_t global[2];
+};
+
+struct gif_writer {
+	FILE *file;
+	int w, h;
+	int frames;                 // frames written
+
+	// frames handed over to the encoder thread
+	unsigned char *queue;       // RENDER_QUEUE frames of w x h
+	int head, count;            // oldest frame and number of frames queued
+	bool closing;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t ready, space;
+
+	// encoder state, only touched by the encoder thread
+	uint16_t (*tree)[256];      // code of a code followed by a pixel, 0 if none
+	unsigned char block[255];   // data sub-block being filled
+	int blockLen;
+	uint32_t bits;              // bits not yet written, LSB first
+	int nbits;
+};
+
+// same arithmetic as render_color in the kernels
+static unsigned char color_of(float t)
+{
+	int c = (int)((t - RENDER_T_MIN) * ((RENDER_COLORS - 1) / (RENDER_T_MAX - RENDER_T_MIN)) + 0.5f);
+	return (unsigned char)(c < 0 ? 0 : (c > RENDER_COLORS - 1 ? RENDER_COLORS - 1 : c));
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the default downsampling factor for an ni x nj field
+//
+//------------------------------------------------------------------------------
+int render_scale(int ni, int nj)
+{
+	int si = (ni - 2 + RENDER_MAX_SIZE - 1) / RENDER_MAX_SIZE;
+	int sj = (nj - 2 + RENDER_MAX_SIZE - 1) / RENDER_MAX_SIZE;
+	int scale = si > sj ? si : sj;
+
+	return scale < 1 ? 1 : scale;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the image size for a field and downsampling factor, the
+//  interior cells are averaged over scale x scale blocks
+//
+//------------------------------------------------------------------------------
+void render_size(int ni, int nj, int scale, int *w, int *h)
+{
+	*w = (ni - 2) / scale;
+	*h = (nj - 2) / scale;
+	if (*w < 1) *w = 1;
+	if (*h < 1) *h = 1;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to render the interior of a field on the host into a w x h image
+//  of palette indices
+//
+//------------------------------------------------------------------------------
+void render_frame_ref(int ni, int nj, int scale, const float *temp, unsigned char *image)
+{
+	int w, h;
+
+	render_size(ni, nj, scale, &w, &h);
+
+	#pragma omp parallel for schedule(static)
+	for ( int y = 0; y < h; y++ ) {
+		for ( int x = 0; x < w; x++ ) {
+			float sum = 0;
+			int n = 0;
+
+			for ( int j = 1 + y*scale; j < 1 + (y+1)*scale && j < nj-1; j++ )
+				for ( int i = 1 + x*scale; i < 1 + (x+1)*scale && i < ni-1; i++ ) {
+					sum += temp[I2D(ni, i, j)];
+					n++;
+				}
+
+			// a field without interior cells (ni or nj <= 2) shows its boundary
+			if (n == 0) {
+				sum = temp[I2D(ni, ni > 1 ? 1 : 0, nj > 1 ? 1 : 0)];
+				n = 1;
+			}
+
+			image[I2D(w, x, y)] = color_of(sum / n);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to set up rendering of ni x nj fields on queue
+//
+//------------------------------------------------------------------------------
+struct render_dev *render_dev_create(cl_context context, cl_program program,
+                                     cl_command_queue queue, int ni, int nj, int scale)
+{
+	cl_int err;
+	int w, h;
+	struct render_dev *r = (struct render_dev *)calloc(1, sizeof(struct render_dev));
+
+	if (!r) {
+		fprintf(stderr, "Error: Could not allocate memory for renderer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	render_size(ni, nj, scale, &w, &h);
+	r->queue = queue;
+	r->global[0] = w;
+	r->global[1] = h;
+
+	r->kernel = clCreateKernel(program, "render_frame", &err);
+	checkError(err, "Creating render_frame");
+	r->image = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)w * h, NULL, &err);
+	checkError(err, "Creating buffer image");
+
+	err =  clSetKernelArg(r->kernel, 0, sizeof(int),    &ni);
+	err |= clSetKernelArg(r->kernel, 1, sizeof(int),    &nj);
+	err |= clSetKernelArg(r->kernel, 2, sizeof(int),    &scale);
+	err |= clSetKernelArg(r->kernel, 3, sizeof(int),    &w);
+	err |= clSetKernelArg(r->kernel, 5, sizeof(cl_mem), &r->image);
+	checkError(err, "Setting render_frame args");
+
+	return r;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to render a field on the device and read back only the image
+//
+//------------------------------------------------------------------------------
+void render_dev_frame(struct render_dev *r, cl_mem temp, unsigned char *image)
+{
+	cl_int err;
+	cl_event event = NULL;
+
+	err = clSetKernelArg(r->kernel, 4, sizeof(cl_mem), &temp);
+	checkError(err, "Setting render_frame args");
+
+	err = clEnqueueNDRangeKernel(r->queue, r->kernel, 2, NULL, r->global, NULL,
+		0, NULL, TRACE_EVENT(event));
+	checkError(err, "Enqueueing render_frame");
+	TRACE_CL(event, "render_frame", "kernel");
+
+	err = clEnqueueReadBuffer(r->queue, r->image, CL_TRUE, 0,
+		r->global[0] * r->global[1], image, 0, NULL, TRACE_EVENT(event));
+	checkError(err, "Reading back image");
+	TRACE_CL(event, "read image", "transfer");
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to release the device objects of a renderer
+//
+//------------------------------------------------------------------------------
+void render_dev_release(struct render_dev *r)
+{
+	clReleaseMemObject(r->image);
+	clReleaseKernel(r->kernel);
+	free(r);
+}
+
+static void put16(FILE *file, int v)
+{
+	fputc(v & 0xff, file);
+	fputc((v >> 8) & 0xff, file);
+}
+
+// appends a byte of image data, in sub-blocks of up to 255 bytes
+static void put_byte(struct gif_writer *g, unsigned char b)
+{
+	g->block[g->blockLen++] = b;
+	if (g->blockLen == 255) {
+		fputc(255, g->file);
+		fwrite(g->block, 1, 255, g->file);
+		g->blockLen = 0;
+	}
+}
+
+static void put_code(struct gif_writer *g, int code, int size)
+{
+	g->bits |= (uint32_t)code << g->nbits;
+	g->nbits += size;
+	while (g->nbits >= 8) {
+		put_byte(g, g->bits & 0xff);
+		g->bits >>= 8;
+		g->nbits -= 8;
+	}
+}
+
+// writes one frame, LZW with codes widening from 9 to 12 bits
+static void encode_frame(struct gif_writer *g, const unsigned char *image)
+{
+	long n = (long)g->w * g->h;
+	int codeSize = LZW_MIN_BITS + 1;
+	int maxCode = LZW_EOI;        // last code in use
+	int cur = image[0];
+
+	// graphic control extension with the delay, then the image descriptor
+	fputc(0x21, g->file); fputc(0xF9, g->file); fputc(4, g->file); fputc(0, g->file);
+	put16(g->file, RENDER_DELAY);
+	fputc(0, g->file); fputc(0, g->file);
+	fputc(0x2C, g->file);
+	put16(g->file, 0); put16(g->file, 0);
+	put16(g->file, g->w); put16(g->file, g->h);
+	fputc(0, g->file);
+	fputc(LZW_MIN_BITS, g->file);
+
+	memset(g->tree, 0, sizeof(g->tree[0]) * LZW_CLEAR);
+	put_code(g, LZW_CLEAR, codeSize);
+
+	for (long p = 1; p < n; p++) {
+		int c = image[p];
+
+		if (g->tree[cur][c]) {
+			cur = g->tree[cur][c];
+			continue;
+		}
+
+		put_code(g, cur, codeSize);
+		g->tree[cur][c] = ++maxCode;
+		memset(g->tree[maxCode], 0, sizeof(g->tree[0]));
+		if (maxCode >= (1 << codeSize))
+			codeSize++;
+
+		// table full, start over
+		if (maxCode == LZW_MAX_CODE) {
+			put_code(g, LZW_CLEAR, codeSize);
+			memset(g->tree, 0, sizeof(g->tree[0]) * LZW_CLEAR);
+			codeSize = LZW_MIN_BITS + 1;
+			maxCode = LZW_EOI;
+		}
+		cur = c;
+	}
+	put_code(g, cur, codeSize);
+
+	// the decoder adds one more code after the last one, which may widen them
+	if (maxCode > LZW_EOI && maxCode + 1 >= (1 << codeSize) && codeSize < 12)
+		codeSize++;
+	put_code(g, LZW_EOI, codeSize);
+
+	if (g->nbits > 0)
+		put_byte(g, g->bits & 0xff);
+	g->bits = 0;
+	g->nbits = 0;
+	if (g->blockLen > 0) {
+		fputc(g->blockLen, g->file);
+		fwrite(g->block, 1, g->blockLen, g->file);
+		g->blockLen = 0;
+	}
+	fputc(0, g->file);
+}
+
+// encoder thread, takes frames off the queue until gif_close
+static void *encoder(void *arg)
+{
+	struct gif_writer *g = (struct gif_writer *)arg;
+	size_t frameSize = (size_t)g->w * g->h;
+
+	pthread_mutex_lock(&g->lock);
+	for (;;) {
+		while (g->count == 0 && !g->closing)
+			pthread_cond_wait(&g->ready, &g->lock);
+		if (g->count == 0)
+			break;
+
+		const unsigned char *frame = g->queue + g->head * frameSize;
+		pthread_mutex_unlock(&g->lock);
+		encode_frame(g, frame);
+		pthread_mutex_lock(&g->lock);
+
+		g->head = (g->head + 1) % RENDER_QUEUE;
+		g->count--;
+		g->frames++;
+		pthread_cond_signal(&g->space);
+	}
+	pthread_mutex_unlock(&g->lock);
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to create an animated GIF of w x h frames, encoded and written by
+//  a background thread
+//
+//------------------------------------------------------------------------------
+struct gif_writer *gif_open(const char *filename, int w, int h)
+{
+	struct gif_writer *g = (struct gif_writer *)calloc(1, sizeof(struct gif_writer));
+
+	if (!g) {
+		fprintf(stderr, "Error: Could not allocate memory for GIF writer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	g->w = w;
+	g->h = h;
+	g->queue = (unsigned char *)malloc((size_t)w * h * RENDER_QUEUE);
+	g->tree = (uint16_t (*)[256])malloc(sizeof(g->tree[0]) * (LZW_MAX_CODE + 1));
+	if (!g->queue || !g->tree) {
+		fprintf(stderr, "Error: Could not allocate memory for GIF writer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	g->file = fopen(filename, "wb");
+	if (!g->file) {
+		fprintf(stderr, "Error: Could not open %s\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	// header with a global 256 colour palette
+	fwrite("GIF89a", 1, 6, g->file);
+	put16(g->file, w);
+	put16(g->file, h);
+	fputc(0xF7, g->file);
+	fputc(0, g->file);
+	fputc(0, g->file);
+	for (int c = 0; c < RENDER_COLORS; c++) {
+		fputc(c, g->file);
+		fputc(0, g->file);
+		fputc(0, g->file);
+	}
+
+	// loop forever
+	fputc(0x21, g->file); fputc(0xFF, g->file); fputc(11, g->file);
+	fwrite("NETSCAPE2.0", 1, 11, g->file);
+	fputc(3, g->file); fputc(1, g->file);
+	put16(g->file, 0);
+	fputc(0, g->file);
+
+	pthread_mutex_init(&g->lock, NULL);
+	pthread_cond_init(&g->ready, NULL);
+	pthread_cond_init(&g->space, NULL);
+	if (pthread_create(&g->thread, NULL, encoder, g) != 0) {
+		fprintf(stderr, "Error: Could not start GIF encoder thread\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return g;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to queue a frame for encoding, waits only if RENDER_QUEUE frames
+//  are already waiting
+//
+//------------------------------------------------------------------------------
+void gif_add_frame(struct gif_writer *g, const unsigned char *image)
+{
+	size_t frameSize = (size_t)g->w * g->h;
+	int slot;
+
+	pthread_mutex_lock(&g->lock);
+	while (g->count == RENDER_QUEUE)
+		pthread_cond_wait(&g->space, &g->lock);
+	slot = (g->head + g->count) % RENDER_QUEUE;
+	pthread_mutex_unlock(&g->lock);
+
+	// the encoder does not look at the slot until it is counted
+	memcpy(g->queue + slot * frameSize, image, frameSize);
+
+	pthread_mutex_lock(&g->lock);
+	g->count++;
+	pthread_cond_signal(&g->ready);
+	pthread_mutex_unlock(&g->lock);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to encode the frames still queued and close the file. Returns the
+//  number of frames written.
+//
+//------------------------------------------------------------------------------
+int gif_close(struct gif_writer *g)
+{
+	int frames;
+
+	pthread_mutex_lock(&g->lock);
+	g->closing = 1;
+	pthread_cond_signal(&g->ready);
+	pthread_mutex_unlock(&g->lock);
+	pthread_join(g->thread, NULL);
+
+	fputc(0x3B, g->file);
+	fclose(g->file);
+	frames = g->frames;
+
+	pthread_mutex_destroy(&g->lock);
+	pthread_cond_destroy(&g->ready);
+	pthread_cond_destroy(&g->space);
+	free(g->queue);
+	free(g->tree);
+	free(g);
+
+	return frames;
+}
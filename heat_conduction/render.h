@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: In-situ rendering include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __RENDER_HDR
+#define __RENDER_HDR
+
+// the RENDER_* constants in C_heat_conduction.cl must match these
+#define RENDER_COLORS    256      // palette entries, images hold 8-bit indices
+#define RENDER_T_MIN     0.0f     // temperatures mapped onto the palette, those of initmat
+#define RENDER_T_MAX     100.0f
+#define RENDER_MAX_SIZE  1024     // default downsampling keeps images within this
+#define RENDER_DELAY     10       // GIF frame delay, hundredths of a second
+#define RENDER_QUEUE     8        // frames waiting for the encoder thread
+
+struct render_dev;
+struct gif_writer;
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the default downsampling factor for an ni x nj field
+//
+//------------------------------------------------------------------------------
+int render_scale(int ni, int nj);
+
+//------------------------------------------------------------------------------
+//
+//  Function to get the image size for a field and downsampling factor, the
+//  interior cells are averaged over scale x scale blocks
+//
+//------------------------------------------------------------------------------
+void render_size(int ni, int nj, int scale, int *w, int *h);
+
+//------------------------------------------------------------------------------
+//
+//  Function to render the interior of a field on the host into a w x h image
+//  of palette indices
+//
+//------------------------------------------------------------------------------
+void render_frame_ref(int ni, int nj, int scale, const float *temp, unsigned char *image);
+
+//------------------------------------------------------------------------------
+//
+//  Function to set up rendering of ni x nj fields on queue
+//
+//------------------------------------------------------------------------------
+struct render_dev *render_dev_create(cl_context context, cl_program program,
+                                     cl_command_queue queue, int ni, int nj, int scale);
+
+//------------------------------------------------------------------------------
+//
+//  Function to render a field on the device and read back only the image
+//
+//------------------------------------------------------------------------------
+void render_dev_frame(struct render_dev *r, cl_mem temp, unsigned char *image);
+
+//------------------------------------------------------------------------------
+//
+//  Function to release the device objects of a renderer
+//
+//------------------------------------------------------------------------------
+void render_dev_release(struct render_dev *r);
+
+//------------------------------------------------------------------------------
+//
+//  Function to create an animated GIF of w x h frames, encoded and written by
+//  a background thread
+//
+//------------------------------------------------------------------------------
+struct gif_writer *gif_open(const char *filename, int w, int h);
+
+//------------------------------------------------------------------------------
+//
+//  Function to queue a frame for encoding, waits only if RENDER_QUEUE frames
+//  are already waiting
+//
+//------------------------------------------------------------------------------
+void gif_add_frame(struct gif_writer *g, const unsigned char *image);
+
+//------------------------------------------------------------------------------
+//
+//  Function to encode the frames still queued and close the file. Returns the
+//  number of frames written.
+//
+//------------------------------------------------------------------------------
+int gif_close(struct gif_writer *g);
+
+#endif
@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Extract a frame, or part of one, from a heat_sim snapshot file
+//
+//  USAGE:   ./snap_extract file frame [i0 j0 width height]
+//           Writes the interior cells of the frame, or of the region given in
+//           field coordinates, to stdout in the layout of heat_con.csv: comma
+//           separated rows followed by a blank line.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include "heat_sim.h"
+#include "snapshot.h"
+
+int main(int argc, char *argv[])
+{
+	int ni, nj, frames;
+
+	if (argc != 3 && argc != 7) {
+		fprintf(stderr, "Usage: %s file frame [i0 j0 width height]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct snap_reader *r = snap_open(argv[1], &ni, &nj, &frames);
+	if (!r) {
+		fprintf(stderr, "Error: %s is not a snapshot file\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	int frame = atoi(argv[2]);
+	int i0 = 0, j0 = 0, w = ni, h = nj;
+	if (argc == 7) {
+		i0 = atoi(argv[3]);
+		j0 = atoi(argv[4]);
+		w = atoi(argv[5]);
+		h = atoi(argv[6]);
+	}
+
+	float *out = (float *)malloc(sizeof(float) * (w > 0 ? w : 1) * (h > 0 ? h : 1));
+	if (snap_read_region(r, frame, i0, j0, w, h, out) != SUCCESS) {
+		fprintf(stderr, "Error: Could not read frame %d (%d frames of %d x %d)\n", frame, frames, ni, nj);
+		return EXIT_FAILURE;
+	}
+
+	// heat_con.csv holds the interior cells only
+	for (int j = 0; j < h; j++) {
+		if (j0 + j < 1 || j0 + j >= nj-1)
+			continue;
+		for (int i = 0; i < w; i++)
+			if (i0 + i >= 1 && i0 + i < ni-1)
+				printf("%f,", out[I2D(w, i, j)]);
+		printf("\n");
+	}
+	printf("\n");
+
+	free(out);
+	snap_close_reader(r);
+	return EXIT_SUCCESS;
+}
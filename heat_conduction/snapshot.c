@@ -0,0 +1,737 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Chunked, compressed snapshot container
+//
+//  PURPOSE: Each frame is cut into SNAP_TILE x SNAP_TILE tiles and every tile
+//           of every frame is stored as its own chunk, so a reader can pull
+//           one frame or a subregion by decompressing only the chunks it
+//           needs. A chunk holds one of
+//             KIND_XOR    float bits XORed with the predictor, lossless
+//             KIND_QUANT  residual from the predictor quantised to 2*errBound
+//           where the predictor is the same tile of the previous frame, or
+//           the previous cell on key frames (every SNAP_KEY-th frame). The
+//           32-bit codes are byte-shuffled into four planes and compressed
+//           in the LZ4 block format. Frames are copied into a queue and
+//           compressed by a pool of worker threads while the run continues.
+//
+//           File layout, integers in host byte order:
+//             header | chunks ... | index (offset, size per frame and tile)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <pthread.h>
+#include "heat_sim.h"
+#include "snapshot.h"
+
+#define SNAP_MAGIC "HSNAP01"
+
+#define KIND_XOR   0
+#define KIND_QUANT 1
+
+#define TILE_CELLS (SNAP_TILE * SNAP_TILE)
+
+#define LZ_HASH_BITS     12
+#define LZ_MIN_MATCH     4
+#define LZ_LAST_LITERALS 5   // the block always ends with this many literals
+#define LZ_MF_LIMIT      12  // no match may start closer than this to the end
+#define LZ_BOUND(n)      ((n) + (n) / 255 + 16)
+
+struct snap_header {
+	char     magic[8];
+	int32_t  ni, nj;
+	int32_t  tile, key;
+	float    errBound;
+	int32_t  frames;
+	uint64_t index;      // file offset of the chunk index
+};
+
+struct snap_chunk {
+	uint64_t offset;
+	uint32_t size;
+	uint32_t unused;
+};
+
+struct snap_writer {
+	FILE *file;
+	struct snap_header head;
+	int ntx, ntiles;
+	uint64_t pos;
+	float *prev;                // last frame as a reader will reconstruct it
+	uint8_t **chunk;            // compressed tiles of the current frame
+	size_t *len;
+	struct snap_chunk *index;
+	size_t maxIndex;
+
+	// frames handed over to the worker threads
+	float *queue;               // SNAP_QUEUE frames of ni x nj
+	int first, count;           // oldest frame and number of frames queued
+	int next, done;             // tiles of the oldest frame taken and finished
+	bool closing;
+	pthread_t thread[SNAP_WORKERS];
+	pthread_mutex_t lock;
+	pthread_cond_t ready, space;
+};
+
+struct snap_reader {
+	char *filename;
+	struct snap_header head;
+	int ntx, ntiles;
+	struct snap_chunk *index;
+};
+
+// per-thread scratch space for one tile
+struct tile_scratch {
+	float cur[TILE_CELLS], prev[TILE_CELLS], vals[TILE_CELLS];
+	uint32_t code[TILE_CELLS];
+	uint8_t bytes[4 * TILE_CELLS];
+};
+
+//------------------------------------------------------------------------------
+//  LZ4 block format
+//------------------------------------------------------------------------------
+
+static uint32_t read32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static uint8_t *lz_put_length(uint8_t *op, size_t len)
+{
+	for ( ; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = (uint8_t)len;
+	return op;
+}
+
+static size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst)
+{
+	int table[1 << LZ_HASH_BITS];
+	const uint8_t *ip = src, *anchor = src, *end = src + n;
+	const uint8_t *mfLimit = n > LZ_MF_LIMIT ? end - LZ_MF_LIMIT : src;
+	uint8_t *op = dst;
+
+	for (int k = 0; k < (1 << LZ_HASH_BITS); k++)
+		table[k] = -1;
+
+	while (ip < mfLimit) {
+		uint32_t seq = read32(ip);
+		int h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+		int cand = table[h];
+		table[h] = (int)(ip - src);
+
+		if (cand < 0 || ip - (src + cand) > 65535 || read32(src + cand) != seq) {
+			ip++;
+			continue;
+		}
+
+		// extend the match forwards, then backwards over pending literals
+		const uint8_t *ref = src + cand;
+		const uint8_t *mEnd = ip + LZ_MIN_MATCH, *r = ref + LZ_MIN_MATCH;
+		while (mEnd < end - LZ_LAST_LITERALS && *mEnd == *r) {
+			mEnd++;
+			r++;
+		}
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		size_t lit = ip - anchor, mLen = mEnd - ip - LZ_MIN_MATCH;
+		size_t offset = ip - ref;
+
+		*op++ = (uint8_t)((lit < 15 ? lit : 15) << 4 | (mLen < 15 ? mLen : 15));
+		if (lit >= 15)
+			op = lz_put_length(op, lit - 15);
+		memcpy(op, anchor, lit);
+		op += lit;
+		*op++ = (uint8_t)(offset & 0xff);
+		*op++ = (uint8_t)(offset >> 8);
+		if (mLen >= 15)
+			op = lz_put_length(op, mLen - 15);
+
+		ip = anchor = mEnd;
+	}
+
+	// final literals
+	size_t lit = end - anchor;
+	*op++ = (uint8_t)((lit < 15 ? lit : 15) << 4);
+	if (lit >= 15)
+		op = lz_put_length(op, lit - 15);
+	memcpy(op, anchor, lit);
+	op += lit;
+
+	return op - dst;
+}
+
+// returns the decompressed size, or -1 if the block is malformed
+static long lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap)
+{
+	const uint8_t *ip = src, *iEnd = src + n;
+	uint8_t *op = dst, *oEnd = dst + cap;
+
+	while (ip < iEnd) {
+		unsigned token = *ip++, b;
+		size_t lit = token >> 4, mLen = token & 15;
+
+		if (lit == 15) {
+			do {
+				if (ip >= iEnd) return -1;
+				lit += b = *ip++;
+			} while (b == 255);
+		}
+		if (lit > (size_t)(iEnd - ip) || lit > (size_t)(oEnd - op))
+			return -1;
+		memcpy(op, ip, lit);
+		ip += lit;
+		op += lit;
+
+		// the last sequence has literals only
+		if (ip == iEnd)
+			break;
+
+		if (iEnd - ip < 2)
+			return -1;
+		size_t offset = ip[0] | (size_t)ip[1] << 8;
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - dst))
+			return -1;
+
+		if (mLen == 15) {
+			do {
+				if (ip >= iEnd) return -1;
+				mLen += b = *ip++;
+			} while (b == 255);
+		}
+		mLen += LZ_MIN_MATCH;
+		if (mLen > (size_t)(oEnd - op))
+			return -1;
+
+		// byte by byte, the match may overlap its own output
+		const uint8_t *ref = op - offset;
+		while (mLen--)
+			*op++ = *ref++;
+	}
+
+	return op - dst;
+}
+
+//------------------------------------------------------------------------------
+//  Tile coding
+//------------------------------------------------------------------------------
+
+static uint32_t float_bits(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, 4);
+	return u;
+}
+
+static float bits_float(uint32_t u)
+{
+	float f;
+	memcpy(&f, &u, 4);
+	return f;
+}
+
+// shared by coder and decoder so both reconstruct bit-identical values
+static float dequant(float pred, int32_t q, double step)
+{
+	return (float)(pred + q * step);
+}
+
+static void tile_rect(const struct snap_header *h, int ntx, int t,
+                      int *i0, int *j0, int *tw, int *th)
+{
+	*i0 = (t % ntx) * h->tile;
+	*j0 = (t / ntx) * h->tile;
+	*tw = h->ni - *i0 < h->tile ? h->ni - *i0 : h->tile;
+	*th = h->nj - *j0 < h->tile ? h->nj - *j0 : h->tile;
+}
+
+// codes s->cur against prev (NULL on key frames), s->vals gets what the
+// decoder will reconstruct; returns the chunk size written to out
+static size_t encode_tile(struct tile_scratch *s, const float *prev, int n,
+                          float errBound, uint8_t *out)
+{
+	int kind = KIND_XOR;
+
+	if (errBound > 0) {
+		double step = 2.0 * errBound;
+		kind = KIND_QUANT;
+		for (int k = 0; k < n; k++) {
+			float pred = prev ? prev[k] : (k ? s->vals[k-1] : 0);
+			double q = rint((s->cur[k] - (double)pred) / step);
+
+			// residual too large for 32 bits, store this tile losslessly
+			if (fabs(q) > 1e9) {
+				kind = KIND_XOR;
+				break;
+			}
+			int32_t qi = (int32_t)q;
+			s->vals[k] = dequant(pred, qi, step);
+
+			// float rounding of the result can overshoot by an ulp, step back
+			if (fabsf(s->vals[k] - s->cur[k]) > errBound) {
+				qi += s->vals[k] > s->cur[k] ? -1 : 1;
+				s->vals[k] = dequant(pred, qi, step);
+				if (fabsf(s->vals[k] - s->cur[k]) > errBound) {
+					kind = KIND_XOR;
+					break;
+				}
+			}
+			s->code[k] = (uint32_t)qi << 1 ^ (uint32_t)(qi >> 31);
+		}
+	}
+
+	if (kind == KIND_XOR) {
+		for (int k = 0; k < n; k++) {
+			uint32_t pred = prev ? float_bits(prev[k]) : (k ? float_bits(s->cur[k-1]) : 0);
+			s->code[k] = float_bits(s->cur[k]) ^ pred;
+			s->vals[k] = s->cur[k];
+		}
+	}
+
+	// byte-shuffle, the high bytes of small codes become runs of zeros
+	for (int p = 0; p < 4; p++)
+		for (int k = 0; k < n; k++)
+			s->bytes[p*n + k] = (uint8_t)(s->code[k] >> (8*p));
+
+	out[0] = (uint8_t)kind;
+	return 1 + lz_compress(s->bytes, 4 * (size_t)n, out + 1);
+}
+
+// decodes a chunk into s->vals given the previous frame (NULL on key frames)
+static int decode_tile(struct tile_scratch *s, const float *prev, int n,
+                       float errBound, const uint8_t *chunk, size_t size)
+{
+	if (size < 1 || lz_decompress(chunk + 1, size - 1, s->bytes, 4 * (size_t)n) != 4 * (long)n)
+		return FAILURE;
+
+	for (int k = 0; k < n; k++)
+		s->code[k] = (uint32_t)s->bytes[k] | (uint32_t)s->bytes[n + k] << 8 |
+		             (uint32_t)s->bytes[2*n + k] << 16 | (uint32_t)s->bytes[3*n + k] << 24;
+
+	if (chunk[0] == KIND_QUANT) {
+		double step = 2.0 * errBound;
+		for (int k = 0; k < n; k++) {
+			float pred = prev ? prev[k] : (k ? s->vals[k-1] : 0);
+			int32_t q = (int32_t)(s->code[k] >> 1 ^ -(s->code[k] & 1));
+			s->vals[k] = dequant(pred, q, step);
+		}
+	}
+	else if (chunk[0] == KIND_XOR) {
+		for (int k = 0; k < n; k++) {
+			uint32_t pred = prev ? float_bits(prev[k]) : (k ? float_bits(s->vals[k-1]) : 0);
+			s->vals[k] = bits_float(s->code[k] ^ pred);
+		}
+	}
+	else
+		return FAILURE;
+
+	return SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//  Worker threads
+//------------------------------------------------------------------------------
+
+// codes tile t of temp against the previous frame, or on its own on key frames
+static void compress_tile(struct snap_writer *w, int t, bool key, const float *temp,
+                          struct tile_scratch *s)
+{
+	struct snap_header *h = &w->head;
+	int i0, j0, tw, th;
+	tile_rect(h, w->ntx, t, &i0, &j0, &tw, &th);
+
+	for (int j = 0; j < th; j++) {
+		memcpy(s->cur + j*tw, temp + I2D(h->ni, i0, j0 + j), sizeof(float) * tw);
+		memcpy(s->prev + j*tw, w->prev + I2D(h->ni, i0, j0 + j), sizeof(float) * tw);
+	}
+
+	w->len[t] = encode_tile(s, key ? NULL : s->prev, tw * th, h->errBound, w->chunk[t]);
+
+	for (int j = 0; j < th; j++)
+		memcpy(w->prev + I2D(h->ni, i0, j0 + j), s->vals + j*tw, sizeof(float) * tw);
+}
+
+// appends the compressed tiles of a finished frame and indexes them
+static void write_chunks(struct snap_writer *w)
+{
+	struct snap_header *h = &w->head;
+
+	size_t need = (size_t)(h->frames + 1) * w->ntiles;
+	if (need > w->maxIndex) {
+		w->maxIndex = 2 * need;
+		w->index = (struct snap_chunk *)realloc(w->index, sizeof(struct snap_chunk) * w->maxIndex);
+	}
+
+	for (int t = 0; t < w->ntiles; t++) {
+		struct snap_chunk *c = &w->index[(size_t)h->frames * w->ntiles + t];
+		c->offset = w->pos;
+		c->size = (uint32_t)w->len[t];
+		c->unused = 0;
+		fwrite(w->chunk[t], 1, w->len[t], w->file);
+		w->pos += w->len[t];
+	}
+
+	h->frames++;
+}
+
+// worker thread, takes tiles of the oldest queued frame until snap_close; a
+// frame's tiles are only handed out once the previous frame is finished
+static void *compressor(void *arg)
+{
+	struct snap_writer *w = (struct snap_writer *)arg;
+	struct tile_scratch *s = (struct tile_scratch *)malloc(sizeof(struct tile_scratch));
+	size_t frameSize = (size_t)w->head.ni * w->head.nj;
+
+	pthread_mutex_lock(&w->lock);
+	for (;;) {
+		while ((w->count == 0 || w->next == w->ntiles) && !(w->count == 0 && w->closing))
+			pthread_cond_wait(&w->ready, &w->lock);
+		if (w->count == 0)
+			break;
+
+		int t = w->next++;
+		bool key = w->head.frames % w->head.key == 0;
+		const float *temp = w->queue + w->first * frameSize;
+		pthread_mutex_unlock(&w->lock);
+		compress_tile(w, t, key, temp, s);
+		pthread_mutex_lock(&w->lock);
+
+		// the last tile of a frame writes it out and frees its slot
+		if (++w->done == w->ntiles) {
+			write_chunks(w);
+			w->first = (w->first + 1) % SNAP_QUEUE;
+			w->count--;
+			w->next = w->done = 0;
+			pthread_cond_broadcast(&w->ready);
+			pthread_cond_signal(&w->space);
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	free(s);
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to create a snapshot file for ni x nj fields. errBound 0 stores
+//  frames losslessly, otherwise every cell is stored within errBound.
+//
+//------------------------------------------------------------------------------
+struct snap_writer *snap_create(const char *filename, int ni, int nj, float errBound)
+{
+	struct snap_writer *w = (struct snap_writer *)calloc(1, sizeof(struct snap_writer));
+
+	w->file = fopen(filename, "wb");
+	if (!w->file) {
+		fprintf(stderr, "Error: Could not open snapshot file %s\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	memcpy(w->head.magic, SNAP_MAGIC, sizeof(w->head.magic));
+	w->head.ni = ni;
+	w->head.nj = nj;
+	w->head.tile = SNAP_TILE;
+	w->head.key = SNAP_KEY;
+	w->head.errBound = errBound > 0 ? errBound : 0;
+
+	w->ntx = (ni + SNAP_TILE - 1) / SNAP_TILE;
+	w->ntiles = w->ntx * ((nj + SNAP_TILE - 1) / SNAP_TILE);
+
+	w->prev = (float *)calloc((size_t)ni * nj, sizeof(float));
+	w->chunk = (uint8_t **)malloc(sizeof(uint8_t *) * w->ntiles);
+	w->len = (size_t *)malloc(sizeof(size_t) * w->ntiles);
+	for (int t = 0; t < w->ntiles; t++)
+		w->chunk[t] = (uint8_t *)malloc(1 + LZ_BOUND(4 * TILE_CELLS));
+	w->queue = (float *)malloc(sizeof(float) * (size_t)ni * nj * SNAP_QUEUE);
+	if (!w->prev || !w->queue) {
+		fprintf(stderr, "Error: Could not allocate memory for snapshot writer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// header is rewritten with the frame count and index offset on close
+	fwrite(&w->head, sizeof(w->head), 1, w->file);
+	w->pos = sizeof(w->head);
+
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->ready, NULL);
+	pthread_cond_init(&w->space, NULL);
+	for (int k = 0; k < SNAP_WORKERS; k++) {
+		if (pthread_create(&w->thread[k], NULL, compressor, w) != 0) {
+			fprintf(stderr, "Error: Could not start snapshot worker thread\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	return w;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to queue a frame, tiles are compressed in parallel by the worker
+//  threads and the call waits only if SNAP_QUEUE frames are already waiting
+//
+//------------------------------------------------------------------------------
+void snap_write_frame(struct snap_writer *w, const float *temp)
+{
+	size_t frameSize = (size_t)w->head.ni * w->head.nj;
+	int slot;
+
+	pthread_mutex_lock(&w->lock);
+	while (w->count == SNAP_QUEUE)
+		pthread_cond_wait(&w->space, &w->lock);
+	slot = (w->first + w->count) % SNAP_QUEUE;
+	pthread_mutex_unlock(&w->lock);
+
+	// the workers do not look at the slot until it is counted
+	memcpy(w->queue + slot * frameSize, temp, sizeof(float) * frameSize);
+
+	pthread_mutex_lock(&w->lock);
+	w->count++;
+	pthread_cond_broadcast(&w->ready);
+	pthread_mutex_unlock(&w->lock);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to compress the frames still queued, write the chunk index and
+//  close the file
+//
+//------------------------------------------------------------------------------
+void snap_close(struct snap_writer *w)
+{
+	pthread_mutex_lock(&w->lock);
+	w->closing = 1;
+	pthread_cond_broadcast(&w->ready);
+	pthread_mutex_unlock(&w->lock);
+	for (int k = 0; k < SNAP_WORKERS; k++)
+		pthread_join(w->thread[k], NULL);
+
+	w->head.index = w->pos;
+	fwrite(w->index, sizeof(struct snap_chunk), (size_t)w->head.frames * w->ntiles, w->file);
+	fseek(w->file, 0, SEEK_SET);
+	fwrite(&w->head, sizeof(w->head), 1, w->file);
+	if (fclose(w->file) != 0)
+		fprintf(stderr, "Error: Could not write snapshot file\n");
+
+	for (int t = 0; t < w->ntiles; t++)
+		free(w->chunk[t]);
+	free(w->chunk);
+	free(w->len);
+	free(w->prev);
+	free(w->index);
+	free(w->queue);
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->ready);
+	pthread_cond_destroy(&w->space);
+	free(w);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to open a snapshot file for reading, NULL if it is not one
+//
+//------------------------------------------------------------------------------
+struct snap_reader *snap_open(const char *filename, int *ni, int *nj, int *frames)
+{
+	struct snap_header head;
+	FILE *file = fopen(filename, "rb");
+	if (!file)
+		return NULL;
+
+	if (fread(&head, sizeof(head), 1, file) != 1 || memcmp(head.magic, SNAP_MAGIC, sizeof(head.magic)) != 0 ||
+	    head.ni <= 0 || head.nj <= 0 || head.tile <= 0 || head.tile > SNAP_TILE || head.key <= 0 ||
+	    head.frames < 0) {
+		fclose(file);
+		return NULL;
+	}
+
+	// the index must lie within the file, so a corrupt header cannot size it
+	long fileSize = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+	size_t ntiles = (size_t)((head.ni - 1) / head.tile + 1) * ((head.nj - 1) / head.tile + 1);
+	if (fileSize < 0 || head.index > (uint64_t)fileSize || ntiles > INT_MAX ||
+	    ((uint64_t)fileSize - head.index) / sizeof(struct snap_chunk) / ntiles < (uint64_t)head.frames) {
+		fclose(file);
+		return NULL;
+	}
+
+	struct snap_reader *r = (struct snap_reader *)calloc(1, sizeof(struct snap_reader));
+	r->head = head;
+	r->ntx = (head.ni - 1) / head.tile + 1;
+	r->ntiles = (int)ntiles;
+
+	size_t count = (size_t)head.frames * r->ntiles;
+	r->index = (struct snap_chunk *)malloc(sizeof(struct snap_chunk) * (count ? count : 1));
+	if (fseek(file, (long)head.index, SEEK_SET) != 0 ||
+	    fread(r->index, sizeof(struct snap_chunk), count, file) != count) {
+		fclose(file);
+		free(r->index);
+		free(r);
+		return NULL;
+	}
+	fclose(file);
+
+	r->filename = (char *)malloc(strlen(filename) + 1);
+	strcpy(r->filename, filename);
+
+	*ni = head.ni;
+	*nj = head.nj;
+	*frames = head.frames;
+	return r;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to read the w x h region at (i0, j0) of one frame into out,
+//  only the tiles overlapping the region are decompressed
+//
+//------------------------------------------------------------------------------
+int snap_read_region(struct snap_reader *r, int frame,
+                     int i0, int j0, int w, int h, float *out)
+{
+	const struct snap_header *hd = &r->head;
+	int status = SUCCESS;
+
+	if (frame < 0 || frame >= hd->frames || i0 < 0 || j0 < 0 || w <= 0 || h <= 0 ||
+	    i0 + w > hd->ni || j0 + h > hd->nj)
+		return FAILURE;
+
+	int tx0 = i0 / hd->tile, tx1 = (i0 + w - 1) / hd->tile;
+	int ty0 = j0 / hd->tile, ty1 = (j0 + h - 1) / hd->tile;
+	int ntw = tx1 - tx0 + 1, need = ntw * (ty1 - ty0 + 1);
+	int key = frame - frame % hd->key;
+
+	// each thread reads its tiles through its own stream
+	#pragma omp parallel
+	{
+		FILE *file = fopen(r->filename, "rb");
+		struct tile_scratch *s = (struct tile_scratch *)malloc(sizeof(struct tile_scratch));
+		uint8_t *chunk = (uint8_t *)malloc(1 + LZ_BOUND(4 * TILE_CELLS));
+
+		#pragma omp for schedule(dynamic)
+		for (int k = 0; k < need; k++) {
+			int t = (ty0 + k / ntw) * r->ntx + tx0 + k % ntw;
+			int ti, tj, tw, th;
+			tile_rect(hd, r->ntx, t, &ti, &tj, &tw, &th);
+
+			// walk forward from the key frame
+			bool ok = file != NULL;
+			for (int f = key; ok && f <= frame; f++) {
+				const struct snap_chunk *c = &r->index[(size_t)f * r->ntiles + t];
+				if (f > key)
+					memcpy(s->prev, s->vals, sizeof(float) * tw * th);
+				ok = c->size <= 1 + LZ_BOUND(4 * TILE_CELLS) &&
+				     fseek(file, (long)c->offset, SEEK_SET) == 0 &&
+				     fread(chunk, 1, c->size, file) == c->size &&
+				     decode_tile(s, f > key ? s->prev : NULL, tw * th, hd->errBound, chunk, c->size) == SUCCESS;
+			}
+
+			if (!ok) {
+				#pragma omp atomic write
+				status = FAILURE;
+				continue;
+			}
+
+			// copy the part of the tile inside the region
+			int ci0 = ti > i0 ? ti : i0, ci1 = ti + tw < i0 + w ? ti + tw : i0 + w;
+			int cj0 = tj > j0 ? tj : j0, cj1 = tj + th < j0 + h ? tj + th : j0 + h;
+			for (int j = cj0; j < cj1; j++)
+				memcpy(out + I2D(w, ci0 - i0, j - j0), s->vals + I2D(tw, ci0 - ti, j - tj),
+					sizeof(float) * (ci1 - ci0));
+		}
+
+		free(chunk);
+		free(s);
+		if (file)
+			fclose(file);
+	}
+
+	return status;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to read a whole frame into out
+//
+//------------------------------------------------------------------------------
+int snap_read_frame(struct snap_reader *r, int frame, float *out)
+{
+	return snap_read_region(r, frame, 0, 0, r->head.ni, r->head.nj, out);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to close a snapshot file opened for reading
+//
+//------------------------------------------------------------------------------
+void snap_close_reader(struct snap_reader *r)
+{
+	free(r->filename);
+	free(r->index);
+	free(r);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to read back a closed snapshot file and compare its first frame
+//  (a key frame), its last frame and a region of the last frame with the
+//  fields that were written. Returns SUCCESS if all are within the bound.
+//
+//------------------------------------------------------------------------------
+int snap_verify(const char *filename, const float *first, const float *last)
+{
+	int ni, nj, frames;
+	struct snap_reader *r = snap_open(filename, &ni, &nj, &frames);
+
+	if (!r || frames < 1) {
+		printf("Problem! %s could not be read back.\n", filename);
+		if (r)
+			snap_close_reader(r);
+		return FAILURE;
+	}
+
+	float bound = r->head.errBound;
+	bool lastKey = (frames - 1) % r->head.key == 0;
+	int lastFrame = frames - 1;
+	int ri = ni / 3, rj = nj / 3, rw = ni / 3 + 1, rh = nj / 3 + 1;
+	float *out = (float *)malloc(sizeof(float) * ni * nj);
+	float err[3] = {-1, -1, -1};   // -1 if the read failed
+
+	if (snap_read_frame(r, 0, out) == SUCCESS) {
+		err[0] = 0;
+		for (size_t k = 0; k < (size_t)ni * nj; k++)
+			err[0] = fmaxf(err[0], fabsf(out[k] - first[k]));
+	}
+	if (snap_read_frame(r, lastFrame, out) == SUCCESS) {
+		err[1] = 0;
+		for (size_t k = 0; k < (size_t)ni * nj; k++)
+			err[1] = fmaxf(err[1], fabsf(out[k] - last[k]));
+	}
+	if (snap_read_region(r, lastFrame, ri, rj, rw, rh, out) == SUCCESS) {
+		err[2] = 0;
+		for (int j = 0; j < rh; j++)
+			for (int i = 0; i < rw; i++)
+				err[2] = fmaxf(err[2], fabsf(out[I2D(rw, i, j)] - last[I2D(ni, ri + i, rj + j)]));
+	}
+
+	free(out);
+	snap_close_reader(r);
+
+	printf("Snapshot round trip: frame 0 (key) %.3e, frame %d (%s) %.3e, %d x %d region at (%d, %d) %.3e.\n",
+		err[0], lastFrame, lastKey ? "key" : "delta", err[1], rw, rh, ri, rj, err[2]);
+	for (int k = 0; k < 3; k++) {
+		if (err[k] < 0 || err[k] > bound) {
+			printf("Problem! The snapshot frames are NOT within the bound of %.3e.\n", bound);
+			return FAILURE;
+		}
+	}
+	return SUCCESS;
+}
@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Snapshot container include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __SNAPSHOT_HDR
+#define __SNAPSHOT_HDR
+
+#define SNAP_TILE     128   // tiles are SNAP_TILE x SNAP_TILE cells
+#define SNAP_KEY      16    // every SNAP_KEY-th frame does not depend on the last
+#define SNAP_QUEUE    2     // frames waiting for the worker threads
+#define SNAP_WORKERS  4     // threads compressing tiles in the background
+
+struct snap_writer;
+struct snap_reader;
+
+//------------------------------------------------------------------------------
+//
+//  Function to create a snapshot file for ni x nj fields. errBound 0 stores
+//  frames losslessly, otherwise every cell is stored within errBound.
+//
+//------------------------------------------------------------------------------
+struct snap_writer *snap_create(const char *filename, int ni, int nj, float errBound);
+
+//------------------------------------------------------------------------------
+//
+//  Function to queue a frame, tiles are compressed in parallel by the worker
+//  threads and the call waits only if SNAP_QUEUE frames are already waiting
+//
+//------------------------------------------------------------------------------
+void snap_write_frame(struct snap_writer *w, const float *temp);
+
+//------------------------------------------------------------------------------
+//
+//  Function to compress the frames still queued, write the chunk index and
+//  close the file
+//
+//------------------------------------------------------------------------------
+void snap_close(struct snap_writer *w);
+
+//------------------------------------------------------------------------------
+//
+//  Function to open a snapshot file for reading, NULL if it is not one
+//
+//------------------------------------------------------------------------------
+struct snap_reader *snap_open(const char *filename, int *ni, int *nj, int *frames);
+
+//------------------------------------------------------------------------------
+//
+//  Function to read the w x h region at (i0, j0) of one frame into out,
+//  only the tiles overlapping the region are decompressed
+//
+//------------------------------------------------------------------------------
+int snap_read_region(struct snap_reader *r, int frame,
+                     int i0, int j0, int w, int h, float *out);
+
+//------------------------------------------------------------------------------
+//
+//  Function to read a whole frame into out
+//
+//------------------------------------------------------------------------------
+int snap_read_frame(struct snap_reader *r, int frame, float *out);
+
+//------------------------------------------------------------------------------
+//
+//  Function to close a snapshot file opened for reading
+//
+//------------------------------------------------------------------------------
+void snap_close_reader(struct snap_reader *r);
+
+//------------------------------------------------------------------------------
+//
+//  Function to read back a closed snapshot file and compare its first frame
+//  (a key frame), its last frame and a region of the last frame with the
+//  fields that were written. Returns SUCCESS if all are within the bound.
+//
+//------------------------------------------------------------------------------
+int snap_verify(const char *filename, const float *first, const float *last);
+
+#endif
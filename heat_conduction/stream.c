@@ -0,0 +1,295 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Out-of-core streaming for fields larger than device memory
+//
+//  PURPOSE: The device engine keeps both fields in host memory (or a mapped
+//           file) and pipes row bands with halos through STREAM_SLOTS pairs
+//           of device buffers, using separate queues for upload, compute and
+//           download so the three overlap. A band of B rows is sent with k
+//           halo rows on each side and stepped k times on the device, after
+//           which its inner B rows are exact and are read back. k is odd, so
+//           the device ping-pong ends in the buffer seeded from the host's
+//           other field, the one the result is written back to, and both
+//           keep the boundary values of the non-streamed run.
+//
+//           The host engine walks one step band by band with prefetch hints,
+//           handing back pages of finished bands when the fields are mapped
+//           from a file, so they may be larger than memory.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "heat_sim.h"
+
+static void finish_event(cl_event event, const char *name, const char *cat, int track)
+{
+	if (trace_on)
+		trace_cl_event(name, cat, track, event);
+	else
+		clReleaseEvent(event);
+}
+
+// applies advice to the pages covering rows j0 to j1-1
+static void advise_rows(float *field, int ni, int j0, int j1, int advice)
+{
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t a = (uintptr_t)(field + I2D((size_t)ni, 0, j0)) & ~(page - 1);
+	uintptr_t b = (uintptr_t)(field + I2D((size_t)ni, 0, j1));
+
+	if (j1 > j0)
+		madvise((void *)a, b - a, advice);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to map count fields of ni x nj cells onto a file, which is created
+//  or truncated. The fields follow each other in the mapping.
+//
+//------------------------------------------------------------------------------
+float *stream_map(const char *filename, int ni, int nj, int count)
+{
+	size_t bytes = sizeof(float) * ni * nj * count;
+
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, bytes) != 0) {
+		fprintf(stderr, "Error: Could not create field file %s\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	void *base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map field file %s\n", filename);
+		exit(EXIT_FAILURE);
+	}
+
+	return (float *)base;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to unmap fields mapped with stream_map
+//
+//------------------------------------------------------------------------------
+void stream_unmap(float *base, int ni, int nj, int count)
+{
+	if (base)
+		munmap(base, sizeof(float) * ni * nj * count);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to pick the largest band that fits STREAM_SLOTS slots of two
+//  buffers in a quarter of the device memory and its maximum allocation
+//
+//------------------------------------------------------------------------------
+int stream_band_rows(cl_device_id device, int ni, int nj, int passSteps)
+{
+	cl_ulong maxAlloc = 0, globalMem = 0;
+
+	clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAlloc, NULL);
+	clGetDeviceInfo(device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMem, NULL);
+
+	cl_ulong budget = globalMem / 4 / (2 * STREAM_SLOTS);
+	if (budget > maxAlloc)
+		budget = maxAlloc;
+
+	long rows = (long)(budget / (sizeof(float) * ni)) - 2 * passSteps;
+
+	// at least STREAM_SLOTS bands, so there is something to overlap
+	long most = (nj - 2 + STREAM_SLOTS - 1) / STREAM_SLOTS;
+	if (rows > most)
+		rows = most;
+
+	return rows < 1 ? 1 : (int)rows;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run tSteps steps on the device through bands of bandRows rows,
+//  passSteps steps per band per pass (rounded down to odd). The fields stay in
+//  host memory, the device only holds STREAM_SLOTS bands. Swaps *temp_in and
+//  *temp_out after each pass so *temp_in holds the result.
+//
+//------------------------------------------------------------------------------
+void stream_run_device(cl_context context, cl_device_id device, cl_program program,
+                       int ni, int nj, float fact, int tSteps, int bandRows, int passSteps,
+                       float **temp_in, float **temp_out, struct stream_stats *st)
+{
+	cl_int err;
+	cl_command_queue qUp, qRun, qDown;
+	cl_mem dA[STREAM_SLOTS], dB[STREAM_SLOTS];
+	cl_command_queue_properties props = trace_on ? CL_QUEUE_PROFILING_ENABLE : 0;
+	size_t rowBytes = sizeof(float) * ni;
+
+	if (passSteps < 1) passSteps = 1;
+	if (passSteps % 2 == 0) passSteps--;
+	if (bandRows > nj - 2) bandRows = nj - 2;
+	if ((size_t)(bandRows + 2 * passSteps) * ni > INT_MAX)
+		bandRows = INT_MAX / ni - 2 * passSteps;   // keep the kernel's int offsets in range
+	if (bandRows < 1) bandRows = 1;
+
+	int maxChunk = bandRows + 2 * passSteps < nj ? bandRows + 2 * passSteps : nj;
+	int nb = (nj - 2 + bandRows - 1) / bandRows;
+
+	memset(st, 0, sizeof(*st));
+	st->bandRows = bandRows;
+	st->passSteps = passSteps;
+
+	qUp = clCreateCommandQueue(context, device, props, &err);
+	checkError(err, "Creating upload queue");
+	qRun = clCreateCommandQueue(context, device, props, &err);
+	checkError(err, "Creating compute queue");
+	qDown = clCreateCommandQueue(context, device, props, &err);
+	checkError(err, "Creating download queue");
+
+	for (int s = 0; s < STREAM_SLOTS; s++) {
+		dA[s] = clCreateBuffer(context, CL_MEM_READ_WRITE, rowBytes * maxChunk, NULL, &err);
+		checkError(err, "Creating band buffer");
+		dB[s] = clCreateBuffer(context, CL_MEM_READ_WRITE, rowBytes * maxChunk, NULL, &err);
+		checkError(err, "Creating band buffer");
+	}
+
+	cl_kernel kernel = clCreateKernel(program, "step_kernel_mod", &err);
+	checkError(err, "Creating streaming kernel");
+	err =  clSetKernelArg(kernel, 0, sizeof(int),   &ni);
+	err |= clSetKernelArg(kernel, 2, sizeof(float), &fact);
+	checkError(err, "Setting streaming kernel args");
+
+	cl_event *evUp = (cl_event *)malloc(sizeof(cl_event) * nb);
+	cl_event *evRun = (cl_event *)malloc(sizeof(cl_event) * nb);
+	cl_event *evDown = (cl_event *)malloc(sizeof(cl_event) * nb);
+
+	double start = wtime();
+
+	for (int remaining = tSteps; remaining > 0; ) {
+		int k = remaining < passSteps ? remaining : passSteps;
+		if (k % 2 == 0) k--;
+		float *cur = *temp_in, *other = *temp_out;
+
+		for (int b = 0; b < nb; b++) {
+			int s = b % STREAM_SLOTS;
+			int r0 = 1 + b * bandRows;
+			int r1 = r0 + bandRows < nj - 1 ? r0 + bandRows : nj - 1;
+			int c0 = r0 - k > 0 ? r0 - k : 0;
+			int c1 = r1 + k < nj ? r1 + k : nj;
+			int cr = c1 - c0;
+
+			// the slot is free once the band that used it has been read back
+			cl_uint nWait = b >= STREAM_SLOTS;
+			const cl_event *wait = nWait ? &evDown[b - STREAM_SLOTS] : NULL;
+
+			// current field with halos, and the parts of the other field
+			// the kernel never writes: global boundary rows, edge columns
+			err = clEnqueueWriteBuffer(qUp, dA[s], CL_FALSE, 0, rowBytes * cr,
+				cur + I2D((size_t)ni, 0, c0), nWait, wait, NULL);
+			if (c0 == 0)
+				err |= clEnqueueWriteBuffer(qUp, dB[s], CL_FALSE, 0, rowBytes,
+					other, 0, NULL, NULL);
+			if (c1 == nj)
+				err |= clEnqueueWriteBuffer(qUp, dB[s], CL_FALSE, rowBytes * (cr - 1), rowBytes,
+					other + I2D((size_t)ni, 0, nj - 1), 0, NULL, NULL);
+			for (int side = 0; side < 2; side++) {
+				const size_t x = side ? sizeof(float) * (ni - 1) : 0;
+				const size_t bufOrigin[3] = {x, 0, 0}, hostOrigin[3] = {x, c0, 0};
+				const size_t region[3] = {sizeof(float), cr, 1};
+				err |= clEnqueueWriteBufferRect(qUp, dB[s], CL_FALSE, bufOrigin, hostOrigin, region,
+					rowBytes, 0, rowBytes, 0, other, 0, NULL, side ? &evUp[b] : NULL);
+			}
+			checkError(err, "Uploading band");
+			clFlush(qUp);
+
+			// k steps, ping-ponging between the slot's buffers
+			const size_t global[2] = {ni - 1, cr - 1};
+			err = clSetKernelArg(kernel, 1, sizeof(int), &cr);
+			for (int t = 0; t < k; t++) {
+				err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), t % 2 ? &dB[s] : &dA[s]);
+				err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), t % 2 ? &dA[s] : &dB[s]);
+				err |= clEnqueueNDRangeKernel(qRun, kernel, 2, NULL, global, NULL,
+					t == 0, t == 0 ? &evUp[b] : NULL, t == k - 1 ? &evRun[b] : NULL);
+			}
+			checkError(err, "Enqueueing band kernel");
+			clFlush(qRun);
+
+			// k is odd so the result is in dB, read back the inner rows
+			const size_t bufOrigin[3] = {sizeof(float), r0 - c0, 0}, hostOrigin[3] = {sizeof(float), r0, 0};
+			const size_t region[3] = {sizeof(float) * (ni - 2), r1 - r0, 1};
+			err = clEnqueueReadBufferRect(qDown, dB[s], CL_FALSE, bufOrigin, hostOrigin, region,
+				rowBytes, 0, rowBytes, 0, other, 1, &evRun[b], &evDown[b]);
+			checkError(err, "Downloading band");
+			clFlush(qDown);
+
+			st->bytesMoved += rowBytes * cr + 2 * sizeof(float) * cr + rowBytes * ((c0 == 0) + (c1 == nj))
+				+ region[0] * region[1];
+		}
+
+		err = clFinish(qDown);
+		checkError(err, "Waiting for pass to finish");
+
+		for (int b = 0; b < nb; b++) {
+			finish_event(evUp[b], "stream upload", "transfer", TRACE_TRACK_UPLOAD);
+			finish_event(evRun[b], "stream band", "kernel", TRACE_TRACK_COMPUTE);
+			finish_event(evDown[b], "stream download", "transfer", TRACE_TRACK_DOWNLOAD);
+		}
+
+		*temp_in = other;
+		*temp_out = cur;
+		remaining -= k;
+		st->passes++;
+	}
+
+	st->runTime = wtime() - start;
+
+	free(evUp);
+	free(evRun);
+	free(evDown);
+	for (int s = 0; s < STREAM_SLOTS; s++) {
+		clReleaseMemObject(dA[s]);
+		clReleaseMemObject(dB[s]);
+	}
+	clReleaseKernel(kernel);
+	clReleaseCommandQueue(qUp);
+	clReleaseCommandQueue(qRun);
+	clReleaseCommandQueue(qDown);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to run one step on the host band by band, bandRows rows at a
+//  time, prefetching the next band. With fileBacked set, pages of bands that
+//  are done are handed back so the fields may be larger than memory.
+//
+//------------------------------------------------------------------------------
+void stream_step_host(int ni, int nj, float fact, int bandRows, bool fileBacked,
+                      float *temp_in, float *temp_out)
+{
+	if (bandRows < 1)
+		bandRows = 1;
+
+	for (int r0 = 1; r0 < nj - 1; r0 += bandRows) {
+		int r1 = r0 + bandRows < nj - 1 ? r0 + bandRows : nj - 1;
+		int n1 = r1 + bandRows < nj - 1 ? r1 + bandRows : nj - 1;
+
+		// fault in the next band while this one is computed
+		if (r1 < nj - 1) {
+			advise_rows(temp_in, ni, r1, n1 + 1, MADV_WILLNEED);
+			advise_rows(temp_out, ni, r1, n1, MADV_WILLNEED);
+		}
+
+		step_kernel_band(ni, nj, r0, r1, fact, temp_in, temp_out);
+
+		// dropping pages of a shared file mapping keeps their contents in the
+		// file, so this is only done there; private memory would lose them
+		if (fileBacked) {
+			advise_rows(temp_in, ni, r0 - 1, r1 - 1, MADV_DONTNEED);
+			advise_rows(temp_out, ni, r0, r1, MADV_DONTNEED);
+		}
+	}
+}
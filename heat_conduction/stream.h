@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Out-of-core streaming include file (function prototypes)
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __STREAM_HDR
+#define __STREAM_HDR
+
+#define STREAM_SLOTS      3     // upload, compute and download in flight at once
+#define STREAM_HOST_BAND  (1 << 24)  // cells per band of the host engine
+
+//------------------------------------------------------------------------------
+//
+//  Results of a streamed device run
+//
+//------------------------------------------------------------------------------
+struct stream_stats {
+	double runTime;     // seconds
+	int    bandRows;    // rows computed per band
+	int    passSteps;   // steps run on each band per pass
+	int    passes;
+	double bytesMoved;  // host <-> device traffic
+};
+
+//------------------------------------------------------------------------------
+//
+//  Function to map count fields of ni x nj cells onto a file, which is created
+//  or truncated. The fields follow each other in the mapping.
+//
+//------------------------------------------------------------------------------
+float *stream_map(const char *filename, int ni, int nj, int count);
+
+//------------------------------------------------------------------------------
+//
+//  Function to unmap fields mapped with stream_map
+//
+//------------------------------------------------------------------------------
+void stream_unmap(float *base, int ni, int nj, int count);
+
+//------------------------------------------------------------------------------
+//
+//  Function to pick the largest band that fits STREAM_SLOTS slots of two
+//  buffers in a quarter of the device memory and its maximum allocation
+//
+//------------------------------------------------------------------------------
+int stream_band_rows(cl_device_id device, int ni, int nj, int passSteps);
+
+//------------------------------------------------------------------------------
+//
+//  Function to run tSteps steps on the device through bands of bandRows rows,
+//  passSteps steps per band per pass (rounded down to odd). The fields stay in
+//  host memory, the device only holds STREAM_SLOTS bands. Swaps *temp_in and
+//  *temp_out after each pass so *temp_in holds the result.
+//
+//------------------------------------------------------------------------------
+void stream_run_device(cl_context context, cl_device_id device, cl_program program,
+                       int ni, int nj, float fact, int tSteps, int bandRows, int passSteps,
+                       float **temp_in, float **temp_out, struct stream_stats *st);
+
+//------------------------------------------------------------------------------
+//
+//  Function to run one step on the host band by band, bandRows rows at a
+//  time, prefetching the next band. With fileBacked set, pages of bands that
+//  are done are handed back so the fields may be larger than memory.
+//
+//------------------------------------------------------------------------------
+void stream_step_host(int ni, int nj, float fact, int bandRows, bool fileBacked,
+                      float *temp_in, float *temp_out);
+
+#endif
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Tracing for the heat conduction driver
+//
+//  PURPOSE: Spans are kept in memory while the program runs and only written
+//           out by trace_close, so recording costs a few stores per span.
+//           Device timestamps are moved onto the host clock using the
+//           smallest host-minus-device difference seen over all events.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#include "heat_sim.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define PID_HOST   0
+#define PID_DEVICE 1
+
+struct trace_rec {
+	const char *name;
+	const char *cat;
+	int    pid, tid;
+	double ts, dur;        // microseconds, device spans on the device clock
+	double queued, submit; // device only, microseconds spent before start
+};
+
+bool trace_on = 0;
+
+static FILE *traceFile;
+static const char *traceName;
+static double traceBase;                 // wtime() when tracing started
+static double clockOffset;               // host minus device clock, microseconds
+static bool haveOffset;
+static struct trace_rec *recs;
+static int nrecs, maxrecs;
+
+static const char *trackNames[TRACE_TRACKS] = {
+	"queue", "upload queue", "compute queue", "download queue"
+};
+
+static void trace_push(const struct trace_rec *r)
+{
+	#pragma omp critical(trace)
+	{
+		if (nrecs == maxrecs) {
+			maxrecs = maxrecs ? 2 * maxrecs : 1024;
+			recs = (struct trace_rec *)realloc(recs, maxrecs * sizeof(struct trace_rec));
+			if (!recs) {
+				fprintf(stderr, "Error: Could not allocate memory for trace\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		recs[nrecs++] = *r;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to start tracing, the trace is written to filename on trace_close
+//
+//------------------------------------------------------------------------------
+void trace_open(const char *filename)
+{
+	traceFile = fopen(filename, "w");
+	if (!traceFile) {
+		fprintf(stderr, "Error: Could not open trace file %s\n", filename);
+		exit(EXIT_FAILURE);
+	}
+	traceName = filename;
+	traceBase = wtime();
+	trace_on = 1;
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to record a host span, start and end as returned by wtime()
+//
+//------------------------------------------------------------------------------
+void trace_span(const char *name, const char *cat, double start, double end)
+{
+	struct trace_rec r = { name, cat, PID_HOST, 0,
+		(start - traceBase) * 1e6, (end - start) * 1e6, 0, 0 };
+#ifdef _OPENMP
+	r.tid = omp_get_thread_num();
+#endif
+	trace_push(&r);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to record the profiling info of an OpenCL event on a device track
+//  and release it, the queue must have been created with CL_QUEUE_PROFILING_ENABLE
+//
+//------------------------------------------------------------------------------
+void trace_cl_event(const char *name, const char *cat, int track, cl_event event)
+{
+	cl_ulong queued, submit, start, end;
+	cl_int err;
+
+	clWaitForEvents(1, &event);
+	double now = (wtime() - traceBase) * 1e6;
+
+	err =  clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL);
+	err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &submit, NULL);
+	err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+	err |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+	clReleaseEvent(event);
+	if (err != CL_SUCCESS)
+		return;
+
+	struct trace_rec r = { name, cat, PID_DEVICE, track,
+		start * 1e-3, (end - start) * 1e-3,
+		(start - queued) * 1e-3, (start - submit) * 1e-3 };
+
+	// the event finished before now, so this bounds the offset from above
+	#pragma omp critical(trace)
+	{
+		if (!haveOffset || now - end * 1e-3 < clockOffset)
+			clockOffset = now - end * 1e-3;
+		haveOffset = 1;
+	}
+	trace_push(&r);
+}
+
+//------------------------------------------------------------------------------
+//
+//  Function to write the trace file and print the summary table
+//
+//------------------------------------------------------------------------------
+void trace_close(void)
+{
+	if (!trace_on)
+		return;
+	trace_on = 0;
+
+	// Chrome trace event format, complete ("X") events in microseconds
+	fprintf(traceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(traceFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"host\"}},\n", PID_HOST);
+	fprintf(traceFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"OpenCL device\"}}", PID_DEVICE);
+
+	// name only the device tracks that were used
+	bool used[TRACE_TRACKS] = { 0 };
+	for (int k = 0; k < nrecs; k++)
+		if (recs[k].pid == PID_DEVICE)
+			used[recs[k].tid] = 1;
+	for (int t = 0; t < TRACE_TRACKS; t++)
+		if (used[t])
+			fprintf(traceFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+				"\"args\":{\"name\":\"%s\"}}", PID_DEVICE, t, trackNames[t]);
+
+	for (int k = 0; k < nrecs; k++) {
+		struct trace_rec *r = &recs[k];
+		double ts = r->pid == PID_DEVICE ? r->ts + clockOffset : r->ts;
+
+		fprintf(traceFile, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+			"\"ts\":%.3f,\"dur\":%.3f", r->name, r->cat, r->pid, r->tid, ts, r->dur);
+		if (r->pid == PID_DEVICE)
+			fprintf(traceFile, ",\"args\":{\"queued_us\":%.3f,\"submit_us\":%.3f}", r->queued, r->submit);
+		fprintf(traceFile, "}");
+	}
+	fprintf(traceFile, "\n]}\n");
+	fclose(traceFile);
+
+	// Summary, one row per distinct name, in order of first appearance
+	printf("\n===== Trace summary, %d spans written to %s ======\n", nrecs, traceName);
+	printf("%-24s %-8s %7s %11s %10s %10s %10s %10s\n",
+		"Name", "Cat", "Count", "Total ms", "Mean ms", "Min ms", "Max ms", "Wait ms");
+
+	bool *done = (bool *)calloc(nrecs, sizeof(bool));
+	for (int k = 0; k < nrecs; k++) {
+		if (done[k])
+			continue;
+
+		int count = 0;
+		double total = 0, wait = 0, lo = recs[k].dur, hi = 0;
+		for (int m = k; m < nrecs; m++) {
+			if (done[m] || recs[m].pid != recs[k].pid || strcmp(recs[m].name, recs[k].name) != 0)
+				continue;
+			done[m] = 1;
+			count++;
+			total += recs[m].dur;
+			wait += recs[m].queued;
+			if (recs[m].dur < lo) lo = recs[m].dur;
+			if (recs[m].dur > hi) hi = recs[m].dur;
+		}
+
+		printf("%-24s %-8s %7d %11.3f %10.3f %10.3f %10.3f %10.3f\n",
+			recs[k].name, recs[k].cat, count, total * 1e-3, total / count * 1e-3,
+			lo * 1e-3, hi * 1e-3, wait / count * 1e-3);
+	}
+	printf("\n");
+
+	free(done);
+	free(recs);
+	recs = NULL;
+	nrecs = maxrecs = 0;
+}
@@ -0,0 +1,61 @@
+//------------------------------------------------------------------------------
+//
+//  PROGRAM: Tracing include file (function prototypes)
+//
+//  PURPOSE: Record host phases, per-thread CPU spans and OpenCL event
+//           profiling, then write a Chrome/Perfetto trace and a summary table.
+//
+//  HISTORY: Written by me, October 2026
+//
+//------------------------------------------------------------------------------
+
+#ifndef __TRACE_HDR
+#define __TRACE_HDR
+
+extern bool trace_on;   // set by trace_open, tested before anything is recorded
+
+// Device tracks, one per command queue so overlapping commands do not nest
+#define TRACE_TRACK_QUEUE     0    // the main queue
+#define TRACE_TRACK_UPLOAD    1    // streaming queues
+#define TRACE_TRACK_COMPUTE   2
+#define TRACE_TRACK_DOWNLOAD  3
+#define TRACE_TRACKS          4
+
+//------------------------------------------------------------------------------
+//
+//  Function to start tracing, the trace is written to filename on trace_close
+//
+//------------------------------------------------------------------------------
+void trace_open(const char *filename);
+
+//------------------------------------------------------------------------------
+//
+//  Function to record a host span, start and end as returned by wtime()
+//
+//------------------------------------------------------------------------------
+void trace_span(const char *name, const char *cat, double start, double end);
+
+//------------------------------------------------------------------------------
+//
+//  Function to record the profiling info of an OpenCL event on a device track
+//  and release it, the queue must have been created with CL_QUEUE_PROFILING_ENABLE
+//
+//------------------------------------------------------------------------------
+void trace_cl_event(const char *name, const char *cat, int track, cl_event event);
+
+//------------------------------------------------------------------------------
+//
+//  Function to write the trace file and print the summary table
+//
+//------------------------------------------------------------------------------
+void trace_close(void);
+
+// Scoped timers, a single branch each when tracing is disabled
+#define TRACE_BEGIN(t)          double t = trace_on ? wtime() : 0
+#define TRACE_END(t, name, cat) do { if (trace_on) trace_span(name, cat, t, wtime()); } while (0)
+
+// Event argument for clEnqueue* calls and the matching record call
+#define TRACE_EVENT(ev)         (trace_on ? &(ev) : NULL)
+#define TRACE_CL(ev, name, cat) do { if (trace_on) trace_cl_event(name, cat, TRACE_TRACK_QUEUE, ev); } while (0)
+
+#endif